@@ -0,0 +1,77 @@
+#!/bin/sh
+# //////////////////////////////////////////////////////////////////
+# File: bench.sh
+# Description: Simulator throughput benchmark. Generates a fixed matrix
+#		of synthetic traces, runs tomsim on each with every
+#		configuration in bench/configs, cycle by cycle and event
+#		driven, and appends one CSV row per run.
+# Usage: bench/bench.sh [instructions] [results_file]
+# //////////////////////////////////////////////////////////////////
+
+SIZE=${1:-1000000}
+OUT=${2:-build/bench/results.csv}
+DIR=build/bench
+CONFIGS=bench/configs
+
+# Trace name and tracegen options, one per line
+TRACES="serial	-c 1000000000 -i 1
+chains	-c 16 -i 4
+wide	-c 4 -i 8
+memory	-m int=30,load=35,store=35 -c 8 -i 4
+muldiv	-m int=40,mul=30,div=30 -c 8 -i 4
+pressure	-c 8 -i 8 -r 2"
+
+# Value of a top level key in the tomsim results
+get() {
+    sed -n "s/^   \"$1\" : \([-0-9.e+]*\).*/\1/p" $DIR/out.json
+}
+
+# Value of a key in the results profile
+getprof() {
+    sed -n "s/^      \"$1\" : \([-0-9.e+]*\).*/\1/p" $DIR/out.json
+}
+
+mkdir -p $DIR $(dirname $OUT)
+
+DATE=$(date -u +%Y-%m-%dT%H:%M:%SZ)
+COMMIT=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+HOST=$(uname -n)
+
+if [ ! -f $OUT ]; then
+    echo "date,commit,host,trace,size,config,mode,instructions,cycles,host_seconds,inst_per_sec,cycles_per_sec,peak_rss_kb" > $OUT
+fi
+
+printf "%-10s %-6s %-6s %12s %12s %9s %12s %10s\n" trace config mode instructions cycles seconds inst/s rss_kb
+
+echo "$TRACES" | while IFS='	' read NAME OPTS; do
+    TRACE=$DIR/$NAME-$SIZE.bin
+
+    # Traces are deterministic, keep them between runs
+    if [ ! -f $TRACE ]; then
+	bin/tracegen -n $SIZE $OPTS -s 1 $TRACE > /dev/null || exit 1
+    fi
+
+    for CFG in $CONFIGS/*.json; do
+	CNAME=$(basename $CFG .json)
+	for MODE in cycle event; do
+	    FLAGS=""
+	    if [ $MODE = event ]; then
+		FLAGS="-e"
+	    fi
+
+	    bin/tomsim -v error $FLAGS $TRACE $CFG $DIR/out.json > /dev/null || exit 1
+
+	    INST=$(get instructions)
+	    CYCLES=$(get cycles)
+	    SECS=$(getprof simulate)
+	    IPS=$(get "sim instructions per second")
+	    CPS=$(get "sim cycles per second")
+	    RSS=$(getprof "peak rss kb")
+
+	    echo "$DATE,$COMMIT,$HOST,$NAME,$SIZE,$CNAME,$MODE,$INST,$CYCLES,$SECS,$IPS,$CPS,$RSS" >> $OUT
+	    printf "%-10s %-6s %-6s %12s %12s %9.3f %12.0f %10s\n" $NAME $CNAME $MODE $INST $CYCLES $SECS $IPS $RSS
+	done
+    done
+done
+
+echo "Results appended to $OUT"
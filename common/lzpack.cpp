@@ -0,0 +1,193 @@
+// //////////////////////////////////////////////////////////////////
+// File: lzpack.cpp
+// Description: LZ77 block codec. A block is a list of sequences,
+//		each a token byte, literals, then a back reference:
+//
+//		token	  high 4 bits literal count, low 4 bits match
+//			  length - LZ_MIN_MATCH, 15 means more follows
+//			  as 255 valued bytes and a final smaller byte
+//		literals  copied as is
+//		offset	  2 bytes little endian, distance back
+//
+//		The last sequence has no back reference and ends the
+//		block.
+// //////////////////////////////////////////////////////////////////
+
+#include "lzpack.h"
+
+#include <string.h>
+#include <vector>
+
+using namespace std;
+
+// Four input bytes
+static inline uint32_t read32(const uint8_t * p) {
+
+    uint32_t value;
+
+    memcpy(&value, p, sizeof(value));
+
+    return value;
+}
+
+// Table slot of four input bytes
+static inline uint32_t hash32(uint32_t value) {
+    return (value * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+// Length past the token nibble, as 255 valued bytes and a remainder
+static inline uint8_t * putLength(uint8_t * out, size_t length) {
+
+    while (length >= 255) {
+	*out++ = 255;
+	length -= 255;
+    }
+    *out++ = length;
+
+    return out;
+}
+
+// One sequence, the back reference is left off when offset is 0
+static uint8_t * putSequence(uint8_t * out, const uint8_t * literals, size_t count, size_t offset, size_t match) {
+
+    uint8_t * token = out++;
+    size_t extra = (offset > 0) ? match - LZ_MIN_MATCH : 0;
+
+    *token = ((count < 15) ? count : 15) << 4;
+    if (count >= 15) {
+	out = putLength(out, count - 15);
+    }
+
+    memcpy(out, literals, count);
+    out += count;
+
+    if (offset > 0) {
+	*token |= (extra < 15) ? extra : 15;
+	*out++ = offset & 0xFF;
+	*out++ = offset >> 8;
+	if (extra >= 15) {
+	    out = putLength(out, extra - 15);
+	}
+    }
+
+    return out;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: size bytes of input, room for lzBound(size) bytes out
+// Outputs: Coded length
+// Description: Greedy parse, each position is looked up in a table
+//		of the last position with the same four bytes
+// /////////////////////////////////////////////////////////////////
+size_t lzCompress(const uint8_t * src, size_t size, uint8_t * dst) {
+
+    vector<uint32_t> table(1 << LZ_HASH_BITS, 0);	// Position + 1
+    uint8_t * out = dst;
+    size_t anchor = 0;			// First literal not yet coded
+    size_t pos = 0;			// Current position
+    size_t cand;			// Earlier position with the same hash
+    size_t length;			// Match length
+    uint32_t value;
+    uint32_t slot;
+
+    while (pos + LZ_MIN_MATCH <= size) {
+	value = read32(src + pos);
+	slot = hash32(value);
+	cand = table[slot];
+	table[slot] = pos + 1;
+
+	if ((cand == 0) || (pos - (cand - 1) > LZ_MAX_OFFSET) || (read32(src + cand - 1) != value)) {
+	    pos++;
+	    continue;
+	}
+	cand--;
+
+	length = LZ_MIN_MATCH;
+	while ((pos + length < size) && (src[cand + length] == src[pos + length])) {
+	    length++;
+	}
+
+	out = putSequence(out, src + anchor, pos - anchor, pos - cand, length);
+	pos += length;
+	anchor = pos;
+    }
+
+    out = putSequence(out, src + anchor, size - anchor, 0, 0);
+
+    return out - dst;
+}
+
+// Length past the token nibble, 0 if it runs off the input
+static inline int getLength(const uint8_t ** in, const uint8_t * end, size_t * length) {
+
+    uint8_t byte;
+
+    do {
+	if (*in >= end) {
+	    return 0;
+	}
+	byte = *(*in)++;
+	*length += byte;
+    } while (byte == 255);
+
+    return 1;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Coded block, room for size bytes out
+// Outputs: 1 if the block decoded to exactly size bytes
+// Description: Every length and offset is checked, a damaged block
+//		fails rather than writing out of bounds
+// /////////////////////////////////////////////////////////////////
+int lzDecompress(const uint8_t * src, size_t length, uint8_t * dst, size_t size) {
+
+    const uint8_t * in = src;
+    const uint8_t * end = src + length;
+    size_t pos = 0;			// Bytes decoded
+    size_t count;			// Literal count
+    size_t match;			// Match length
+    size_t offset;			// Match distance
+    uint8_t token;
+
+    while (in < end) {
+	token = *in++;
+
+	count = token >> 4;
+	if ((count == 15) && (!getLength(&in, end, &count))) {
+	    return 0;
+	}
+	if ((count > (size_t) (end - in)) || (count > size - pos)) {
+	    return 0;
+	}
+	memcpy(dst + pos, in, count);
+	in += count;
+	pos += count;
+
+	// Last sequence
+	if (in == end) {
+	    break;
+	}
+
+	if (end - in < 2) {
+	    return 0;
+	}
+	offset = in[0] | (in[1] << 8);
+	in += 2;
+
+	match = (token & 15) + LZ_MIN_MATCH;
+	if (((token & 15) == 15) && (!getLength(&in, end, &match))) {
+	    return 0;
+	}
+	if ((offset == 0) || (offset > pos) || (match > size - pos)) {
+	    return 0;
+	}
+
+	// Matches may overlap what they copy
+	for (size_t i = 0; i < match; ++i) {
+	    dst[pos + i] = dst[pos - offset + i];
+	}
+	pos += match;
+    }
+
+    return pos == size;
+}
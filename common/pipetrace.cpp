@@ -0,0 +1,100 @@
+// //////////////////////////////////////////////////////////////////
+// File: pipetrace.cpp
+// Description: Writing and reading of pipeline event traces
+// //////////////////////////////////////////////////////////////////
+
+#include "pipetrace.h"
+
+#include <string.h>
+
+using namespace std;
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Output file name and the FU class labels
+// Outputs: 1 if the file was opened
+// /////////////////////////////////////////////////////////////////
+int openPipeRecorder(PipeRecorder * rec, const char * filename, const vector<string> & labels) {
+
+    PipeHeader header;
+    char label[PIPE_LABEL];
+
+    rec -> ring = NULL;
+    rec -> count = 0;
+    rec -> total = 0;
+
+    rec -> out.open(filename, ios::binary | ios::trunc);
+
+    if (!rec -> out.is_open()) {
+	return 0;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PIPE_MAGIC, sizeof(header.magic));
+    header.version = PIPE_VERSION;
+    header.numClasses = labels.size();
+    rec -> out.write((const char *) &header, sizeof(header));
+
+    for (size_t i = 0; i < labels.size(); ++i) {
+	memset(label, 0, sizeof(label));
+	strncpy(label, labels[i].c_str(), sizeof(label) - 1);
+	rec -> out.write(label, sizeof(label));
+    }
+
+    rec -> ring = new PipeEvent[PIPE_BLOCK];
+
+    return 1;
+}
+
+// Write the buffered events
+void flushPipeRecorder(PipeRecorder * rec) {
+
+    rec -> out.write((const char *) rec -> ring, rec -> count * sizeof(PipeEvent));
+    rec -> total += rec -> count;
+    rec -> count = 0;
+
+    return;
+}
+
+// Write the remaining events and close the file
+void closePipeRecorder(PipeRecorder * rec) {
+
+    if (rec -> ring != NULL) {
+	flushPipeRecorder(rec);
+	delete [] rec -> ring;
+	rec -> ring = NULL;
+    }
+
+    rec -> out.close();
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Event trace stream
+// Outputs: 1 if the header is valid, and the FU class labels
+// Description: Leaves the stream at the first event
+// /////////////////////////////////////////////////////////////////
+int readPipeHeader(istream & in, vector<string> * labels) {
+
+    PipeHeader header;
+    char label[PIPE_LABEL];
+
+    in.read((char *) &header, sizeof(header));
+
+    if ((!in) || (memcmp(header.magic, PIPE_MAGIC, sizeof(header.magic)) != 0) || (header.version != PIPE_VERSION)) {
+	return 0;
+    }
+
+    labels -> clear();
+
+    for (uint32_t i = 0; i < header.numClasses; ++i) {
+	in.read(label, sizeof(label));
+	if (!in) {
+	    return 0;
+	}
+	label[PIPE_LABEL - 1] = '\0';
+	labels -> push_back(label);
+    }
+
+    return 1;
+}
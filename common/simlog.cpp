@@ -0,0 +1,79 @@
+// //////////////////////////////////////////////////////////////////
+// File: simlog.cpp
+// Description: Parsing of log levels and categories
+// //////////////////////////////////////////////////////////////////
+
+#include "simlog.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+using namespace std;
+
+// Names indexed by LogLevel
+static const char * levelNames[] = {"error", "info", "debug", "trace"};
+
+// Category names and bits
+static const char * catNames[] = {"issue", "ro", "exec", "wb", "rename", "config"};
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Level name or number
+// Outputs: LogLevel, -1 if unknown
+// /////////////////////////////////////////////////////////////////
+int parseLogLevel(const char * name) {
+
+    for (int i = LOG_ERROR; i <= LOG_TRACE; ++i) {
+	if (strcmp(name, levelNames[i]) == 0) {
+	    return i;
+	}
+    }
+
+    if ((name[0] >= '0') && (name[0] <= '9')) {
+	int level = atoi(name);
+	return (level > LOG_TRACE) ? LOG_TRACE : level;
+    }
+
+    return -1;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Comma separated category names, or "all"
+// Outputs: 1 and the category mask, 0 if a name is unknown
+// /////////////////////////////////////////////////////////////////
+int parseLogMask(const char * names, unsigned * mask) {
+
+    string list = names;
+    string name;
+    size_t start = 0;
+    size_t end;
+    size_t i;
+
+    *mask = 0;
+
+    while (start <= list.size()) {
+	end = list.find(',', start);
+	if (end == string::npos) {
+	    end = list.size();
+	}
+	name = list.substr(start, end - start);
+	start = end + 1;
+
+	if (name == "all") {
+	    *mask |= LOG_ALL;
+	    continue;
+	}
+
+	for (i = 0; i < sizeof(catNames) / sizeof(catNames[0]); ++i) {
+	    if (name == catNames[i]) {
+		*mask |= 1 << i;
+		break;
+	    }
+	}
+	if (i == sizeof(catNames) / sizeof(catNames[0])) {
+	    return 0;
+	}
+    }
+
+    return 1;
+}
@@ -0,0 +1,358 @@
+// //////////////////////////////////////////////////////////////////
+// File: timeline.cpp
+// Description: Writing and reading of per instruction timelines
+// //////////////////////////////////////////////////////////////////
+
+#include "timeline.h"
+
+#include <string.h>
+
+using namespace std;
+
+const char * timelineNames[TL_NUM] = {"seq", "issue", "read", "exec", "done", "wb", "station", "fu", "op", "unit"};
+const int timelineWidth[TL_NUM] = {4, 8, 8, 8, 8, 8, 2, 2, 1, 1};
+
+// Bytes of a group of rows
+static uint64_t groupBytes(uint64_t rows) {
+
+    uint64_t bytes = sizeof(uint32_t);
+
+    for (int f = 0; f < TL_NUM; ++f) {
+	bytes += rows * timelineWidth[f];
+    }
+
+    return bytes;
+}
+
+// Column f of a row, narrowed to its stored width
+static void putField(char * dst, const TimelineRow & row, int f) {
+
+    uint64_t value = timelineValue(row, f);
+
+    switch (timelineWidth[f]) {
+	case (8):
+	    memcpy(dst, &value, 8);
+	    break;
+	case (4): {
+	    uint32_t v = value;
+	    memcpy(dst, &v, 4);
+	    break;
+	}
+	case (2): {
+	    uint16_t v = value;
+	    memcpy(dst, &v, 2);
+	    break;
+	}
+	default:
+	    *dst = (uint8_t) value;
+	    break;
+    }
+
+    return;
+}
+
+// Set column f of a row
+static void setField(TimelineRow * row, int f, uint64_t value) {
+
+    switch (f) {
+	case (TL_SEQ):
+	    row -> seq = value;
+	    break;
+	case (TL_ISSUE):
+	    row -> issue = value;
+	    break;
+	case (TL_READ):
+	    row -> read = value;
+	    break;
+	case (TL_EXEC):
+	    row -> exec = value;
+	    break;
+	case (TL_DONE):
+	    row -> done = value;
+	    break;
+	case (TL_WB):
+	    row -> wb = value;
+	    break;
+	case (TL_STATION):
+	    row -> station = value;
+	    break;
+	case (TL_FU):
+	    row -> fu = value;
+	    break;
+	case (TL_OP):
+	    row -> op = value;
+	    break;
+	case (TL_UNIT):
+	    row -> unit = value;
+	    break;
+    }
+
+    return;
+}
+
+// Write the finished rows as one group
+static void writeGroup(TimelineWriter * tl) {
+
+    uint32_t rows = tl -> group.size();
+    char * dst;
+
+    if (rows == 0) {
+	return;
+    }
+
+    tl -> buffer.resize(groupBytes(rows));
+    dst = tl -> buffer.data();
+    memcpy(dst, &rows, sizeof(rows));
+    dst += sizeof(rows);
+
+    for (int f = 0; f < TL_NUM; ++f) {
+	for (uint32_t r = 0; r < rows; ++r) {
+	    putField(dst, tl -> group[r], f);
+	    dst += timelineWidth[f];
+	}
+    }
+
+    tl -> out.write(tl -> buffer.data(), tl -> buffer.size());
+    tl -> total += rows;
+    tl -> group.clear();
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Output file name, the FU class labels and the number of
+//		reservation stations, the first size of the ring
+// Outputs: 1 if the file was opened
+// /////////////////////////////////////////////////////////////////
+int openTimeline(TimelineWriter * tl, const char * filename, const vector<string> & labels, int stations) {
+
+    TimelineHeader header;
+    char label[TL_LABEL];
+    uint64_t size = 1;
+
+    tl -> head = 0;
+    tl -> tail = 0;
+    tl -> total = 0;
+
+    tl -> out.open(filename, ios::binary | ios::trunc);
+
+    if (!tl -> out.is_open()) {
+	return 0;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TL_MAGIC, sizeof(header.magic));
+    header.version = TL_VERSION;
+    header.numClasses = labels.size();
+    header.groupRows = TL_GROUP;
+    tl -> out.write((const char *) &header, sizeof(header));
+
+    for (size_t i = 0; i < labels.size(); ++i) {
+	memset(label, 0, sizeof(label));
+	strncpy(label, labels[i].c_str(), sizeof(label) - 1);
+	tl -> out.write(label, sizeof(label));
+    }
+
+    // Every station may hold a row, older finished rows grow the ring
+    while (size <= (uint64_t) stations) {
+	size <<= 1;
+    }
+    tl -> ring.assign(size, TimelineRow());
+    tl -> mask = size - 1;
+    tl -> row.assign(stations, -1);
+    tl -> group.reserve(TL_GROUP);
+
+    return 1;
+}
+
+// Double the ring, rows keep their numbers and move to their new slots
+void growTimeline(TimelineWriter * tl) {
+
+    vector<TimelineRow> ring(2 * tl -> ring.size());
+    uint64_t mask = ring.size() - 1;
+
+    for (uint64_t n = tl -> head; n < tl -> tail; ++n) {
+	ring[n & mask] = tl -> ring[n & tl -> mask];
+    }
+
+    tl -> ring.swap(ring);
+    tl -> mask = mask;
+
+    return;
+}
+
+// Move the oldest finished rows to the group, writing it when full
+void retireTimeline(TimelineWriter * tl) {
+
+    while ((tl -> head < tl -> tail) && (tl -> ring[tl -> head & tl -> mask].complete)) {
+	tl -> group.push_back(tl -> ring[tl -> head & tl -> mask]);
+	(tl -> head)++;
+	if (tl -> group.size() == TL_GROUP) {
+	    writeGroup(tl);
+	}
+    }
+
+    return;
+}
+
+// Write every row, including those of a run stopped part way, and close
+void closeTimeline(TimelineWriter * tl) {
+
+    while (tl -> head < tl -> tail) {
+	tl -> ring[tl -> head & tl -> mask].complete = 1;
+	retireTimeline(tl);
+    }
+    writeGroup(tl);
+
+    tl -> out.close();
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Timeline file name
+// Outputs: 1 if the file is a timeline, with its labels and row count
+// /////////////////////////////////////////////////////////////////
+int openTimelineReader(TimelineReader * tr, const char * filename) {
+
+    TimelineHeader header;
+    char label[TL_LABEL];
+    uint64_t size;
+    uint64_t full;
+
+    tr -> in.open(filename, ios::binary);
+
+    if (!tr -> in.is_open()) {
+	return 0;
+    }
+
+    tr -> in.read((char *) &header, sizeof(header));
+
+    if ((!tr -> in) || (memcmp(header.magic, TL_MAGIC, sizeof(header.magic)) != 0) || (header.version != TL_VERSION) || (header.groupRows == 0)) {
+	return 0;
+    }
+
+    tr -> labels.clear();
+    for (uint32_t i = 0; i < header.numClasses; ++i) {
+	tr -> in.read(label, sizeof(label));
+	if (!tr -> in) {
+	    return 0;
+	}
+	label[TL_LABEL - 1] = '\0';
+	tr -> labels.push_back(label);
+    }
+
+    tr -> groupRows = header.groupRows;
+    tr -> start = tr -> in.tellg();
+
+    // Full groups, then the rows of the last one
+    tr -> in.seekg(0, ios::end);
+    size = (uint64_t) tr -> in.tellg() - tr -> start;
+    full = size / groupBytes(tr -> groupRows);
+    tr -> rows = full * tr -> groupRows;
+    size -= full * groupBytes(tr -> groupRows);
+    if (size > sizeof(uint32_t)) {
+	tr -> rows += (size - sizeof(uint32_t)) / (groupBytes(1) - sizeof(uint32_t));
+    }
+
+    return 1;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Group number
+// Outputs: 1 and the rows of the group, 0 past the end
+// /////////////////////////////////////////////////////////////////
+int readTimelineGroup(TimelineReader * tr, uint64_t group, vector<TimelineRow> * rows) {
+
+    vector<char> buffer;
+    uint32_t count = 0;
+    const char * src;
+
+    tr -> in.clear();
+    tr -> in.seekg(tr -> start + group * groupBytes(tr -> groupRows));
+    tr -> in.read((char *) &count, sizeof(count));
+
+    if ((!tr -> in) || (count == 0) || (count > tr -> groupRows)) {
+	return 0;
+    }
+
+    buffer.resize(groupBytes(count) - sizeof(count));
+    tr -> in.read(buffer.data(), buffer.size());
+
+    if (!tr -> in) {
+	return 0;
+    }
+
+    rows -> assign(count, TimelineRow());
+    src = buffer.data();
+
+    for (int f = 0; f < TL_NUM; ++f) {
+	for (uint32_t r = 0; r < count; ++r) {
+	    TimelineRow & row = (*rows)[r];
+	    uint64_t v64 = 0;
+	    uint32_t v32 = 0;
+	    uint16_t v16 = 0;
+	    switch (timelineWidth[f]) {
+		case (8):
+		    memcpy(&v64, src, 8);
+		    break;
+		case (4):
+		    memcpy(&v32, src, 4);
+		    v64 = v32;
+		    break;
+		case (2):
+		    memcpy(&v16, src, 2);
+		    v64 = v16;
+		    break;
+		default:
+		    v64 = (uint8_t) *src;
+		    break;
+	    }
+	    src += timelineWidth[f];
+	    setField(&row, f, v64);
+	}
+    }
+
+    return 1;
+}
+
+// Value of one column of a row
+uint64_t timelineValue(const TimelineRow & row, int field) {
+
+    uint64_t value = 0;
+
+    switch (field) {
+	case (TL_SEQ):
+	    value = row.seq;
+	    break;
+	case (TL_ISSUE):
+	    value = row.issue;
+	    break;
+	case (TL_READ):
+	    value = row.read;
+	    break;
+	case (TL_EXEC):
+	    value = row.exec;
+	    break;
+	case (TL_DONE):
+	    value = row.done;
+	    break;
+	case (TL_WB):
+	    value = row.wb;
+	    break;
+	case (TL_STATION):
+	    value = row.station;
+	    break;
+	case (TL_FU):
+	    value = row.fu;
+	    break;
+	case (TL_OP):
+	    value = row.op;
+	    break;
+	case (TL_UNIT):
+	    value = row.unit;
+	    break;
+    }
+
+    return value;
+}
@@ -0,0 +1,865 @@
+// //////////////////////////////////////////////////////////////////
+// File: tracefile.cpp
+// Description: Reading and writing of text and binary traces
+// //////////////////////////////////////////////////////////////////
+
+#include "tracefile.h"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <chrono>
+
+using namespace std;
+
+// Instruction names indexed by Instruction_Name
+static const char * opNames[TRACE_NUM_OPS] = {
+    "ADD", "SUB", "AND", "NOR", "DIV", "MUL", "MOD", "EXP",
+    "LW", "SW", "LIZ", "LIS", "LUI", "HALT", "PUT"
+};
+
+// Length of each name
+static const size_t opLengths[TRACE_NUM_OPS] = {
+    3, 3, 3, 3, 3, 3, 3, 3,
+    2, 2, 3, 3, 3, 4, 3
+};
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Instruction_Name value
+// Outputs: Name used in text traces
+// /////////////////////////////////////////////////////////////////
+const char * traceOpName(int op) {
+
+    if ((op < 0) || (op >= TRACE_NUM_OPS)) {
+	return "???";
+    }
+
+    return opNames[op];
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Name used in text traces
+// Outputs: Instruction_Name value, -1 if unknown
+// /////////////////////////////////////////////////////////////////
+int traceOpCode(const string & name) {
+
+    for (int i = 0; i < TRACE_NUM_OPS; ++i) {
+	if (name == opNames[i]) {
+	    return i;
+	}
+    }
+
+    return -1;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Trace file name
+// Outputs: 1 if the file starts with the binary trace magic
+// /////////////////////////////////////////////////////////////////
+int traceFileIsBinary(const char * filename) {
+    return traceFileFormat(filename) == TRACE_BINARY;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Trace file name
+// Outputs: TraceFormat told by the magic at the start of the file,
+//		anything else is read as text
+// /////////////////////////////////////////////////////////////////
+int traceFileFormat(const char * filename) {
+
+    ifstream infile;
+    char magic[4];
+
+    infile.open(filename, ios::binary);
+
+    if (!infile.is_open()) {
+	return TRACE_TEXT;
+    }
+
+    infile.read(magic, sizeof(magic));
+
+    if (infile.gcount() != sizeof(magic)) {
+	return TRACE_TEXT;
+    }
+    if (memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0) {
+	return TRACE_BINARY;
+    }
+    if (memcmp(magic, PACK_MAGIC, sizeof(magic)) == 0) {
+	return TRACE_PACKED;
+    }
+
+    return TRACE_TEXT;
+}
+
+// Register number from a name such as "R6"
+static uint8_t regNumber(const string & reg) {
+
+    if (reg.size() < 2) {
+	return 0;
+    }
+
+    return (reg[1] - '0') & 0x07;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Text trace stream
+// Outputs: Next instruction, returns 0 at end of file
+// Description: Unknown tokens are skipped
+// /////////////////////////////////////////////////////////////////
+int readTextRecord(istream & in, TraceRecord * rec) {
+
+    string token;
+    string a, b, c;
+    int op;
+
+    while (in >> token) {
+	op = traceOpCode(token);
+	if (op < 0) {
+	    continue;
+	}
+
+	memset(rec, 0, sizeof(*rec));
+	rec -> op = op;
+
+	switch (op) {
+	    case (N_LW):
+		in >> a >> b;
+		rec -> rd = regNumber(a);
+		rec -> rs = regNumber(b);
+		break;
+	    case (N_SW):
+		in >> a >> b;
+		rec -> rt = regNumber(a);
+		rec -> rs = regNumber(b);
+		break;
+	    case (N_LIZ):
+	    case (N_LIS):
+	    case (N_LUI):
+		in >> a >> b;
+		rec -> rd = regNumber(a);
+		rec -> imm8 = atoi(b.c_str()) & 0xFF;
+		break;
+	    case (N_PUT):
+		in >> a;
+		rec -> rs = regNumber(a);
+		break;
+	    case (N_HALT):
+		break;
+	    default:
+		in >> a >> b >> c;
+		rec -> rd = regNumber(a);
+		rec -> rs = regNumber(b);
+		rec -> rt = regNumber(c);
+		break;
+	}
+
+	return 1;
+    }
+
+    return 0;
+}
+
+// White space as skipped by stream extraction
+static inline int textSpace(char c) {
+    return (c == ' ') || ((c >= '\t') && (c <= '\r'));
+}
+
+// Next token of a mapped text trace, empty at the end of the chunk
+static inline const char * nextToken(const char ** pos, const char * end, size_t * length) {
+
+    const char * start = *pos;
+
+    while ((start < end) && textSpace(*start)) {
+	start++;
+    }
+
+    *pos = start;
+    while ((*pos < end) && (!textSpace(**pos))) {
+	(*pos)++;
+    }
+    *length = *pos - start;
+
+    return start;
+}
+
+// Register number of a token, as regNumber
+static inline uint8_t tokenReg(const char * token, size_t length) {
+    return (length < 2) ? 0 : (token[1] - '0') & 0x07;
+}
+
+// Immediate of a token, as atoi
+static inline uint8_t tokenImm(const char * token, size_t length) {
+
+    char value[TRACE_LINE];
+
+    length = (length < sizeof(value)) ? length : sizeof(value) - 1;
+    memcpy(value, token, length);
+    value[length] = '\0';
+
+    return atoi(value) & 0xFF;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Part of a mapped text trace, ending at a line boundary
+// Outputs: Its instructions, parsed the same as readTextRecord
+// /////////////////////////////////////////////////////////////////
+static void parseTextChunk(const char * pos, const char * end, vector<TraceRecord> * records) {
+
+    const char * token;
+    const char * reg[3];
+    size_t length;
+    size_t regLength[3];
+    int op;
+    int operands;
+    TraceRecord rec;
+
+    // A text record is at least "HALT\n"
+    records -> reserve((end - pos) / 8);
+
+    while ((token = nextToken(&pos, end, &length)), length > 0) {
+	for (op = 0; op < TRACE_NUM_OPS; ++op) {
+	    if ((opLengths[op] == length) && (memcmp(opNames[op], token, length) == 0)) {
+		break;
+	    }
+	}
+	if (op == TRACE_NUM_OPS) {
+	    continue;
+	}
+
+	switch (op) {
+	    case (N_HALT):
+		operands = 0;
+		break;
+	    case (N_PUT):
+		operands = 1;
+		break;
+	    case (N_LW):
+	    case (N_SW):
+	    case (N_LIZ):
+	    case (N_LIS):
+	    case (N_LUI):
+		operands = 2;
+		break;
+	    default:
+		operands = 3;
+		break;
+	}
+	for (int i = 0; i < operands; ++i) {
+	    reg[i] = nextToken(&pos, end, &(regLength[i]));
+	}
+
+	memset(&rec, 0, sizeof(rec));
+	rec.op = op;
+
+	switch (op) {
+	    case (N_LW):
+		rec.rd = tokenReg(reg[0], regLength[0]);
+		rec.rs = tokenReg(reg[1], regLength[1]);
+		break;
+	    case (N_SW):
+		rec.rt = tokenReg(reg[0], regLength[0]);
+		rec.rs = tokenReg(reg[1], regLength[1]);
+		break;
+	    case (N_LIZ):
+	    case (N_LIS):
+	    case (N_LUI):
+		rec.rd = tokenReg(reg[0], regLength[0]);
+		rec.imm8 = tokenImm(reg[1], regLength[1]);
+		break;
+	    case (N_PUT):
+		rec.rs = tokenReg(reg[0], regLength[0]);
+		break;
+	    case (N_HALT):
+		break;
+	    default:
+		rec.rd = tokenReg(reg[0], regLength[0]);
+		rec.rs = tokenReg(reg[1], regLength[1]);
+		rec.rt = tokenReg(reg[2], regLength[2]);
+		break;
+	}
+
+	records -> push_back(rec);
+    }
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Text trace file name, number of threads
+// Outputs: 1 and the instructions up to and including HALT
+// Description: The mapped file is split at line boundaries into one
+//		chunk per thread. The chunks are parsed at once and
+//		then copied in order into records, also in parallel.
+// /////////////////////////////////////////////////////////////////
+int parseTextTrace(const char * filename, vector<TraceRecord> * records, int threads) {
+
+    struct stat info;
+    int fd;
+    void * base;
+    const char * text;
+    size_t length;
+    vector<size_t> bounds;			// Chunk starts, then the end
+    vector<vector<TraceRecord> > chunks;	// Records per chunk
+    vector<size_t> first;			// First record of each chunk
+    vector<thread> pool;
+    size_t total = 0;
+    size_t halt;
+    int n;
+
+    records -> clear();
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+	return 0;
+    }
+
+    if (fstat(fd, &info) < 0) {
+	close(fd);
+	return 0;
+    }
+
+    length = info.st_size;
+    if (length == 0) {
+	close(fd);
+	return 1;
+    }
+
+    base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+	close(fd);
+	return 0;
+    }
+    text = (const char *) base;
+
+    // Small traces are not worth a thread each
+    if (threads < 1) {
+	threads = 1;
+    }
+    if ((size_t) threads > length / TRACE_CHUNK + 1) {
+	threads = length / TRACE_CHUNK + 1;
+    }
+
+    // Each chunk starts just after a newline
+    bounds.push_back(0);
+    for (n = 1; n < threads; ++n) {
+	size_t at = max(length / threads * n, bounds.back());
+	while ((at < length) && (text[at - 1] != '\n')) {
+	    at++;
+	}
+	bounds.push_back(at);
+    }
+    bounds.push_back(length);
+
+    chunks.resize(threads);
+    for (n = 0; n < threads; ++n) {
+	pool.push_back(thread(parseTextChunk, text + bounds[n], text + bounds[n + 1], &chunks[n]));
+    }
+    for (n = 0; n < threads; ++n) {
+	pool[n].join();
+    }
+    pool.clear();
+
+    munmap(base, length);
+    close(fd);
+
+    // Nothing after the first HALT is kept
+    for (n = 0; n < threads; ++n) {
+	for (halt = 0; (halt < chunks[n].size()) && (chunks[n][halt].op != N_HALT); ++halt);
+	if (halt < chunks[n].size()) {
+	    chunks[n].resize(halt + 1);
+	    chunks.resize(n + 1);
+	    break;
+	}
+    }
+
+    for (n = 0; n < (int) chunks.size(); ++n) {
+	first.push_back(total);
+	total += chunks[n].size();
+    }
+
+    records -> resize(total);
+    for (n = 0; n < (int) chunks.size(); ++n) {
+	pool.push_back(thread([records, &chunks, &first, n] {
+	    if (!chunks[n].empty()) {
+		memcpy(records -> data() + first[n], chunks[n].data(), chunks[n].size() * sizeof(TraceRecord));
+	    }
+	    vector<TraceRecord>().swap(chunks[n]);
+	}));
+    }
+    for (n = 0; n < (int) pool.size(); ++n) {
+	pool[n].join();
+    }
+
+    return 1;
+}
+
+// Append " R<reg>" or " <value>" to a text record
+static char * putField(char * line, uint8_t value, int reg) {
+
+    *line++ = ' ';
+    if (reg) {
+	*line++ = 'R';
+    }
+    if (value >= 100) {
+	*line++ = '0' + value / 100;
+    }
+    if (value >= 10) {
+	*line++ = '0' + (value / 10) % 10;
+    }
+    *line++ = '0' + value % 10;
+
+    return line;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Buffer of at least TRACE_LINE bytes and instruction
+// Outputs: Length of the line
+// Description: Formats the instruction as one line of a text trace
+// /////////////////////////////////////////////////////////////////
+int formatTextRecord(char * line, const TraceRecord & rec) {
+
+    const char * name = traceOpName(rec.op);
+    char * end = line;
+
+    while (*name) {
+	*end++ = *name++;
+    }
+
+    switch (rec.op) {
+	case (N_LW):
+	    end = putField(end, rec.rd, 1);
+	    end = putField(end, rec.rs, 1);
+	    break;
+	case (N_SW):
+	    end = putField(end, rec.rt, 1);
+	    end = putField(end, rec.rs, 1);
+	    break;
+	case (N_LIZ):
+	case (N_LIS):
+	case (N_LUI):
+	    end = putField(end, rec.rd, 1);
+	    end = putField(end, rec.imm8, 0);
+	    break;
+	case (N_PUT):
+	    end = putField(end, rec.rs, 1);
+	    break;
+	case (N_HALT):
+	    break;
+	default:
+	    end = putField(end, rec.rd, 1);
+	    end = putField(end, rec.rs, 1);
+	    end = putField(end, rec.rt, 1);
+	    break;
+    }
+
+    *end++ = '\n';
+
+    return end - line;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Output stream and instruction
+// Description: Writes the instruction as one line of a text trace
+// /////////////////////////////////////////////////////////////////
+void writeTextRecord(ostream & out, const TraceRecord & rec) {
+
+    char line[TRACE_LINE];
+
+    out.write(line, formatTextRecord(line, rec));
+
+    return;
+}
+
+// Write all of a buffer, 0 on error
+static int writeAll(int fd, const char * data, size_t length) {
+
+    ssize_t n;
+
+    while (length > 0) {
+	n = write(fd, data, length);
+	if (n < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    return 0;
+	}
+	data += n;
+	length -= n;
+    }
+
+    return 1;
+}
+
+// Writer thread: write each buffer handed over until the writer closes
+static void writeBuffers(TraceWriter * writer) {
+
+    unique_lock<mutex> guard(writer -> lock);
+    size_t length;
+    size_t written = 0;
+    int index;
+    int ok;
+
+    while (1) {
+	writer -> wake.wait(guard, [writer] { return (writer -> pending > 0) || writer -> closing; });
+	if (writer -> pending == 0) {
+	    break;
+	}
+
+	// The filling side only touches the other buffer meanwhile
+	length = writer -> pending;
+	index = 1 - writer -> fill;
+	guard.unlock();
+	if (writer -> packed) {
+	    ok = writePackedBlock(writer, writer -> buffer[index].data(), length);
+	}
+	else {
+	    ok = writeAll(writer -> fd, writer -> buffer[index].data(), length);
+	    written = length;
+	}
+	guard.lock();
+
+	if (!ok) {
+	    writer -> failed = 1;
+	}
+	if (!writer -> packed) {
+	    writer -> bytes += written;
+	}
+	writer -> pending = 0;
+	writer -> wake.notify_all();
+    }
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Output file name and TraceFormat
+// Outputs: 1 if the file was opened
+// /////////////////////////////////////////////////////////////////
+int openTraceWriter(TraceWriter * writer, const char * filename, int format) {
+
+    TraceHeader header;
+    int binary = (format == TRACE_BINARY);
+
+    writer -> binary = (format != TRACE_TEXT);
+    writer -> packed = (format == TRACE_PACKED);
+    writer -> count = 0;
+    writer -> bytes = 0;
+    writer -> fill = 0;
+    writer -> used = 0;
+    writer -> pending = 0;
+    writer -> closing = 0;
+    writer -> failed = 0;
+    writer -> waitNs = 0;
+
+    writer -> fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (writer -> fd < 0) {
+	return 0;
+    }
+
+    writer -> buffer[0].resize(TRACE_BUFFER);
+    writer -> buffer[1].resize(TRACE_BUFFER);
+
+    // Packed blocks are exactly one full buffer of records
+    writer -> limit = TRACE_BUFFER - (writer -> binary ? sizeof(TraceRecord) : TRACE_LINE);
+    if (writer -> packed && (!startPackedTrace(writer))) {
+	close(writer -> fd);
+	return 0;
+    }
+
+    // Count is filled in when the writer is closed
+    if (binary) {
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	memcpy(writer -> buffer[0].data(), &header, sizeof(header));
+	writer -> used = sizeof(header);
+    }
+
+    writer -> thread = std::thread(writeBuffers, writer);
+
+    return 1;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Description: Hands the filled buffer to the writer thread and
+//		carries on in the other one, waiting only while the
+//		thread is still writing the previous buffer
+// /////////////////////////////////////////////////////////////////
+void flushTraceBuffer(TraceWriter * writer) {
+
+    unique_lock<mutex> guard(writer -> lock);
+    chrono::steady_clock::time_point start;
+
+    if (writer -> pending > 0) {
+	start = chrono::steady_clock::now();
+	writer -> wake.wait(guard, [writer] { return writer -> pending == 0; });
+	writer -> waitNs += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    }
+
+    if (writer -> used > 0) {
+	writer -> pending = writer -> used;
+	writer -> fill = 1 - writer -> fill;
+	writer -> used = 0;
+	writer -> wake.notify_all();
+    }
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Outputs: 1 if every record reached the file
+// Description: Writes what is buffered, finishes the header and
+//		closes the trace
+// /////////////////////////////////////////////////////////////////
+int closeTraceWriter(TraceWriter * writer) {
+
+    flushTraceBuffer(writer);
+
+    {
+	lock_guard<mutex> guard(writer -> lock);
+	writer -> closing = 1;
+	writer -> wake.notify_all();
+    }
+    writer -> thread.join();
+
+    if (writer -> packed) {
+	if (!finishPackedTrace(writer)) {
+	    writer -> failed = 1;
+	}
+    }
+    else if (writer -> binary) {
+	if (pwrite(writer -> fd, &(writer -> count), sizeof(writer -> count), offsetof(TraceHeader, count)) != sizeof(writer -> count)) {
+	    writer -> failed = 1;
+	}
+    }
+
+    if (close(writer -> fd) != 0) {
+	writer -> failed = 1;
+    }
+
+    return !writer -> failed;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Binary trace file name
+// Outputs: 1 if the trace was mapped
+// Description: Records are used in place from the mapping
+// /////////////////////////////////////////////////////////////////
+int mapTrace(const char * filename, MappedTrace * trace) {
+
+    struct stat info;
+    const TraceHeader * header;
+
+    memset(trace, 0, sizeof(*trace));
+    trace -> fd = open(filename, O_RDONLY);
+
+    if (trace -> fd < 0) {
+	return 0;
+    }
+
+    if ((fstat(trace -> fd, &info) < 0) || ((size_t) info.st_size < sizeof(TraceHeader))) {
+	close(trace -> fd);
+	return 0;
+    }
+
+    trace -> length = info.st_size;
+    trace -> base = mmap(NULL, trace -> length, PROT_READ, MAP_PRIVATE, trace -> fd, 0);
+
+    if (trace -> base == MAP_FAILED) {
+	close(trace -> fd);
+	return 0;
+    }
+
+    header = (const TraceHeader *) trace -> base;
+
+    if ((memcmp(header -> magic, TRACE_MAGIC, sizeof(header -> magic)) != 0) || (header -> version != TRACE_VERSION) ||
+	(header -> count > (trace -> length - sizeof(TraceHeader)) / sizeof(TraceRecord))) {
+	unmapTrace(trace);
+	return 0;
+    }
+
+    // Records are read front to back
+    madvise(trace -> base, trace -> length, MADV_SEQUENTIAL);
+
+    trace -> records = (const TraceRecord *) ((const char *) trace -> base + sizeof(TraceHeader));
+    trace -> count = header -> count;
+
+    return 1;
+}
+
+// Release a mapped trace
+void unmapTrace(MappedTrace * trace) {
+
+    if (trace -> base != NULL) {
+	munmap(trace -> base, trace -> length);
+    }
+    if (trace -> fd >= 0) {
+	close(trace -> fd);
+    }
+
+    trace -> base = NULL;
+    trace -> records = NULL;
+    trace -> fd = -1;
+    trace -> count = 0;
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Trace file name in either format
+// Outputs: 1 if the trace was opened
+// /////////////////////////////////////////////////////////////////
+int openTraceReader(TraceReader * reader, const char * filename) {
+
+    int format = traceFileFormat(filename);
+
+    reader -> pos = 0;
+    reader -> binary = (format == TRACE_BINARY);
+    reader -> packed = (format == TRACE_PACKED);
+
+    if (reader -> binary) {
+	return mapTrace(filename, &(reader -> mapped));
+    }
+
+    if (reader -> packed) {
+	return openPackedStream(&(reader -> stream), filename);
+    }
+
+    reader -> text.open(filename);
+
+    return reader -> text.is_open();
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Open trace reader
+// Outputs: Next instruction, NULL at end of trace
+// Description: Binary records point into the mapping. Text records
+//		are valid until the next call.
+// /////////////////////////////////////////////////////////////////
+const TraceRecord * readTrace(TraceReader * reader) {
+
+    if (reader -> binary) {
+	if (reader -> pos >= reader -> mapped.count) {
+	    return NULL;
+	}
+	return &(reader -> mapped.records[(reader -> pos)++]);
+    }
+
+    if (reader -> packed) {
+	return readPacked(&(reader -> stream));
+    }
+
+    if (!readTextRecord(reader -> text, &(reader -> scratch))) {
+	return NULL;
+    }
+
+    return &(reader -> scratch);
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Open binary or packed trace reader, record number
+// Outputs: 1 if the trace has that many records
+// Description: The next record read is the given one
+// /////////////////////////////////////////////////////////////////
+int seekTrace(TraceReader * reader, uint64_t record) {
+
+    if (reader -> packed) {
+	return seekPacked(&(reader -> stream), record);
+    }
+
+    if ((!reader -> binary) || (record > reader -> mapped.count)) {
+	return 0;
+    }
+
+    reader -> pos = record;
+
+    return 1;
+}
+
+// Close a trace reader
+void closeTraceReader(TraceReader * reader) {
+
+    if (reader -> binary) {
+	unmapTrace(&(reader -> mapped));
+    }
+    else if (reader -> packed) {
+	closePackedStream(&(reader -> stream));
+    }
+    else {
+	reader -> text.close();
+    }
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Trace file name in any format, threads for text parsing
+// Outputs: 1 if the trace was loaded
+// Description: Text traces are parsed up to and including HALT
+// /////////////////////////////////////////////////////////////////
+int loadTraceStore(TraceStore * store, const char * filename, int threads) {
+
+    PackedTrace packed;
+    vector<TraceRecord> block;
+    vector<uint8_t> columns;
+
+    store -> parsed.clear();
+    store -> mapped.fd = -1;
+    store -> mapped.base = NULL;
+    store -> records = NULL;
+    store -> count = 0;
+
+    if (traceFileIsBinary(filename)) {
+	if (!mapTrace(filename, &(store -> mapped))) {
+	    return 0;
+	}
+	store -> records = store -> mapped.records;
+	store -> count = store -> mapped.count;
+	return 1;
+    }
+
+    if (traceFileFormat(filename) == TRACE_PACKED) {
+	if (!mapPackedTrace(filename, &packed)) {
+	    return 0;
+	}
+	store -> parsed.reserve(packed.count);
+	for (uint64_t b = 0; b < packed.header -> blocks; ++b) {
+	    if (!unpackBlock(&packed, b, &block, &columns)) {
+		unmapPackedTrace(&packed);
+		return 0;
+	    }
+	    store -> parsed.insert(store -> parsed.end(), block.begin(), block.end());
+	}
+	unmapPackedTrace(&packed);
+	store -> records = store -> parsed.data();
+	store -> count = store -> parsed.size();
+	return 1;
+    }
+
+    if (!parseTextTrace(filename, &(store -> parsed), threads)) {
+	return 0;
+    }
+
+    store -> records = store -> parsed.data();
+    store -> count = store -> parsed.size();
+
+    return 1;
+}
+
+// Release a loaded trace
+void freeTraceStore(TraceStore * store) {
+
+    if (store -> mapped.base != NULL) {
+	unmapTrace(&(store -> mapped));
+    }
+
+    store -> parsed.clear();
+    store -> records = NULL;
+    store -> count = 0;
+
+    return;
+}
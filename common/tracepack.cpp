@@ -0,0 +1,343 @@
+// //////////////////////////////////////////////////////////////////
+// File: tracepack.cpp
+// Description: Packed traces. Records are stored in blocks of
+//		PACK_BLOCK that are compressed on their own, with an
+//		index at the end of the file, so record n is found in
+//		block n / PACK_BLOCK without reading the others.
+// //////////////////////////////////////////////////////////////////
+
+#include "tracefile.h"
+#include "lzpack.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Write all of a buffer at an offset, 0 on error
+static int writeAt(int fd, const void * data, size_t length, uint64_t offset) {
+
+    const char * next = (const char *) data;
+    ssize_t n;
+
+    while (length > 0) {
+	n = pwrite(fd, next, length, offset);
+	if (n <= 0) {
+	    return 0;
+	}
+	next += n;
+	offset += n;
+	length -= n;
+    }
+
+    return 1;
+}
+
+// Header of a packed trace, the index is found at the end
+static void fillHeader(PackHeader * header, uint64_t count, uint32_t blocks, uint64_t index) {
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header -> magic, PACK_MAGIC, sizeof(header -> magic));
+    header -> version = PACK_VERSION;
+    header -> count = count;
+    header -> blockRecords = PACK_BLOCK;
+    header -> blocks = blocks;
+    header -> index = index;
+
+    return;
+}
+
+// Write the header of an empty packed trace
+int startPackedTrace(TraceWriter * writer) {
+
+    PackHeader header;
+
+    fillHeader(&header, 0, 0, 0);
+
+    writer -> index.clear();
+    writer -> columns.resize(TRACE_BUFFER);
+    writer -> coded.resize(lzBound(TRACE_BUFFER));
+    writer -> bytes = sizeof(header);
+
+    return writeAt(writer -> fd, &header, sizeof(header), 0);
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Writer, block of whole records
+// Outputs: 1 if the block was written
+// Description: Runs on the writer thread. The records are split
+//		into byte columns first, which puts the few opcodes
+//		and registers next to each other for the coder.
+// /////////////////////////////////////////////////////////////////
+int writePackedBlock(TraceWriter * writer, const char * data, size_t length) {
+
+    const uint8_t * raw = (const uint8_t *) data;
+    uint8_t * columns = writer -> columns.data();
+    size_t records = length / sizeof(TraceRecord);
+    PackBlock block;
+
+    for (size_t r = 0; r < records; ++r) {
+	for (size_t c = 0; c < sizeof(TraceRecord); ++c) {
+	    columns[c * records + r] = raw[r * sizeof(TraceRecord) + c];
+	}
+    }
+
+    block.offset = writer -> bytes;
+    block.length = lzCompress(columns, length, writer -> coded.data());
+    block.records = records;
+
+    if (!writeAt(writer -> fd, writer -> coded.data(), block.length, block.offset)) {
+	return 0;
+    }
+
+    writer -> index.push_back(block);
+    writer -> bytes += block.length;
+
+    return 1;
+}
+
+// Write the index after the last block and complete the header
+int finishPackedTrace(TraceWriter * writer) {
+
+    PackHeader header;
+    uint64_t index = writer -> bytes;
+    size_t length = writer -> index.size() * sizeof(PackBlock);
+
+    fillHeader(&header, writer -> count, writer -> index.size(), index);
+
+    if (!writeAt(writer -> fd, writer -> index.data(), length, index)) {
+	return 0;
+    }
+    writer -> bytes += length;
+
+    return writeAt(writer -> fd, &header, sizeof(header), 0);
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Packed trace file name
+// Outputs: 1 if the trace was mapped and its index is sound
+// Description: Blocks are decompressed as they are read
+// /////////////////////////////////////////////////////////////////
+int mapPackedTrace(const char * filename, PackedTrace * trace) {
+
+    struct stat info;
+    const PackHeader * header;
+    const PackBlock * block;
+    uint64_t total = 0;
+
+    memset(trace, 0, sizeof(*trace));
+    trace -> fd = open(filename, O_RDONLY);
+
+    if (trace -> fd < 0) {
+	return 0;
+    }
+
+    if ((fstat(trace -> fd, &info) < 0) || ((size_t) info.st_size < sizeof(PackHeader))) {
+	close(trace -> fd);
+	trace -> fd = -1;
+	return 0;
+    }
+
+    trace -> length = info.st_size;
+    trace -> base = mmap(NULL, trace -> length, PROT_READ, MAP_PRIVATE, trace -> fd, 0);
+
+    if (trace -> base == MAP_FAILED) {
+	close(trace -> fd);
+	trace -> fd = -1;
+	trace -> base = NULL;
+	return 0;
+    }
+
+    header = (const PackHeader *) trace -> base;
+    trace -> header = header;
+
+    if ((memcmp(header -> magic, PACK_MAGIC, sizeof(header -> magic)) != 0) || (header -> version != PACK_VERSION) ||
+	(header -> blockRecords != PACK_BLOCK) || (header -> index < sizeof(PackHeader)) || (header -> index > trace -> length) ||
+	(header -> blocks > (trace -> length - header -> index) / sizeof(PackBlock))) {
+	unmapPackedTrace(trace);
+	return 0;
+    }
+
+    trace -> index = (const PackBlock *) ((const char *) trace -> base + header -> index);
+
+    // Blocks lie between the header and the index, all full but the last
+    for (uint32_t b = 0; b < header -> blocks; ++b) {
+	block = &(trace -> index[b]);
+	if ((block -> offset < sizeof(PackHeader)) || (block -> offset > header -> index) || (block -> length > header -> index - block -> offset) ||
+	    (block -> records > PACK_BLOCK) || ((b + 1 < header -> blocks) && (block -> records != PACK_BLOCK))) {
+	    unmapPackedTrace(trace);
+	    return 0;
+	}
+	total += block -> records;
+    }
+
+    if (total != header -> count) {
+	unmapPackedTrace(trace);
+	return 0;
+    }
+
+    trace -> count = header -> count;
+
+    return 1;
+}
+
+// Release a packed trace
+void unmapPackedTrace(PackedTrace * trace) {
+
+    if (trace -> base != NULL) {
+	munmap(trace -> base, trace -> length);
+    }
+    if (trace -> fd >= 0) {
+	close(trace -> fd);
+    }
+
+    trace -> base = NULL;
+    trace -> header = NULL;
+    trace -> index = NULL;
+    trace -> fd = -1;
+    trace -> count = 0;
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Mapped packed trace, block number, scratch for one block
+// Outputs: 1 and the records of the block, 0 if it is damaged
+// /////////////////////////////////////////////////////////////////
+int unpackBlock(const PackedTrace * trace, uint64_t block, vector<TraceRecord> * records, vector<uint8_t> * columns) {
+
+    const PackBlock * entry = &(trace -> index[block]);
+    const uint8_t * coded = (const uint8_t *) trace -> base + entry -> offset;
+    size_t length = entry -> records * sizeof(TraceRecord);
+    uint8_t * raw;
+
+    columns -> resize(length);
+    records -> resize(entry -> records);
+
+    if (!lzDecompress(coded, entry -> length, columns -> data(), length)) {
+	return 0;
+    }
+
+    raw = (uint8_t *) records -> data();
+    for (size_t r = 0; r < entry -> records; ++r) {
+	for (size_t c = 0; c < sizeof(TraceRecord); ++c) {
+	    raw[r * sizeof(TraceRecord) + c] = (*columns)[c * entry -> records + r];
+	}
+    }
+
+    return 1;
+}
+
+// Helper thread: decompress blocks in order into the free slots. The
+// ring holds at most PACK_AHEAD slots, with one more being read and
+// one more being filled, so a slot is never filled while it is read.
+static void unpackAhead(PackedStream * stream) {
+
+    const PackedTrace * trace = &(stream -> trace);
+    int slot;
+
+    for (uint64_t b = stream -> first; b < trace -> header -> blocks; ++b) {
+	slot = (b - stream -> first) % (PACK_AHEAD + 2);
+	if (!unpackBlock(trace, b, &(stream -> slots[slot]), &(stream -> columns))) {
+	    stream -> damaged.store(1);
+	    break;
+	}
+	if (!ringPush(&(stream -> ready), slot)) {
+	    break;
+	}
+    }
+
+    ringFinish(&(stream -> ready));
+
+    return;
+}
+
+// Start the helper at the block holding the next record
+static void startHelper(PackedStream * stream) {
+
+    initRing(&(stream -> ready), PACK_AHEAD);
+    stream -> first = stream -> start / PACK_BLOCK;
+    stream -> skip = stream -> start % PACK_BLOCK;
+    stream -> slot = -1;
+    stream -> pos = 0;
+    stream -> helper = thread(unpackAhead, stream);
+
+    return;
+}
+
+// Stop the helper, which may be waiting on a full ring
+static void stopHelper(PackedStream * stream) {
+
+    if (stream -> helper.joinable()) {
+	ringCancel(&(stream -> ready));
+	stream -> helper.join();
+    }
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Packed trace file name
+// Outputs: 1 if the trace was opened
+// Description: The helper starts with the first read, so a stream
+//		that is never read has no thread to stop
+// /////////////////////////////////////////////////////////////////
+int openPackedStream(PackedStream * stream, const char * filename) {
+
+    stream -> damaged.store(0);
+    stream -> start = 0;
+
+    if (!mapPackedTrace(filename, &(stream -> trace))) {
+	return 0;
+    }
+
+    // Blocks are read front to back
+    madvise(stream -> trace.base, stream -> trace.length, MADV_SEQUENTIAL);
+
+    return 1;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Outputs: Next record, NULL at the end of the trace or at a damaged
+//		block. Records are valid until the next block is taken.
+// /////////////////////////////////////////////////////////////////
+const TraceRecord * readPacked(PackedStream * stream) {
+
+    if (!stream -> helper.joinable()) {
+	startHelper(stream);
+    }
+
+    while ((stream -> slot < 0) || (stream -> pos >= stream -> slots[stream -> slot].size())) {
+	if (!ringPop(&(stream -> ready), &(stream -> slot))) {
+	    return NULL;
+	}
+	stream -> pos = stream -> skip;
+	stream -> skip = 0;
+    }
+
+    return &(stream -> slots[stream -> slot][(stream -> pos)++]);
+}
+
+// Continue from a record, the helper restarts at its block
+int seekPacked(PackedStream * stream, uint64_t record) {
+
+    if (record > stream -> trace.count) {
+	return 0;
+    }
+
+    stopHelper(stream);
+    stream -> start = record;
+
+    return 1;
+}
+
+// Stop the helper and release the trace
+void closePackedStream(PackedStream * stream) {
+
+    stopHelper(stream);
+    unmapPackedTrace(&(stream -> trace));
+
+    return;
+}
@@ -0,0 +1,117 @@
+// //////////////////////////////////////////////////////////////////
+// File: xprog.cpp
+// Description: Loads XSim programs and decodes them to trace records
+//		in program order, the same records xsim writes
+// //////////////////////////////////////////////////////////////////
+
+#include "xprog.h"
+
+#include <ctype.h>
+
+using namespace std;
+
+// Value of up to two hex digits, stopping at the first other character
+static unsigned char hexByte(const string & text) {
+
+    unsigned int value = 0;
+
+    for (size_t i = 0; (i < text.size()) && isalnum(text[i]); ++i) {
+	value <<= 4;
+	if ((text[i] >= 'A') && (text[i] <= 'F')) {
+	    value |= text[i] - 'A' + 10;
+	}
+	else if ((text[i] >= 'a') && (text[i] <= 'f')) {
+	    value |= text[i] - 'a' + 10;
+	}
+	else {
+	    value |= text[i] - '0';
+	}
+    }
+
+    return value;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Program file, one 16-bit instruction in hex per line,
+//		lines starting with # are comments
+// Outputs: Number of instructions, -1 if the file is not open
+// /////////////////////////////////////////////////////////////////
+int loadProgram(XProgram * prog, const char * filename) {
+
+    ifstream infile;
+    string line;
+    int i = 0;
+
+    infile.open(filename);
+
+    if (!infile.is_open()) {
+	return -1;
+    }
+
+    memset(prog -> memory, 0, sizeof(prog -> memory));
+    prog -> pc = 0;
+    prog -> halted = 0;
+    prog -> decoded = 0;
+
+    while (getline(infile, line) && (i < MEM_SIZE)) {
+	if (line[0] != '#') {
+	    prog -> memory[i++] = hexByte(line.substr(0, 2));
+	    prog -> memory[i++] = hexByte(line.substr(2, 2));
+	}
+    }
+
+    infile.close();
+
+    return i / 2;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Outputs: 1 and the next record, 0 once HALT has been decoded
+// Description: There are no branches, instructions run in address
+//		order. Reserved and invalid opcodes produce no record.
+// /////////////////////////////////////////////////////////////////
+int decodeNext(XProgram * prog, TraceRecord * rec) {
+
+    XInst xi;
+    uint16_t inst;
+
+    while (!prog -> halted) {
+#ifdef DEBUG
+	cout << "PC: " << prog -> pc << endl;
+#endif
+
+	inst = (prog -> memory[prog -> pc] << 8) | prog -> memory[(uint16_t) (prog -> pc + 1)];
+	prog -> pc += 2;
+
+#ifdef DEBUG
+	cout << hex << inst << "\t" << dec;
+#endif
+
+	if (!decodeInst(inst, &xi)) {
+#ifdef DEBUG
+	    if (xi.format == XF_INVALID) {
+		cout << "Invalid Opcode: " << (inst >> 11) << endl;
+	    }
+#endif
+	    continue;
+	}
+
+#ifdef DEBUG
+	cout << traceOpName(xi.op) << "\tR" << (int) xi.rd;
+	if (xi.format == XF_I) {
+	    cout << "\t" << (int) xi.imm8 << endl;
+	}
+	else {
+	    cout << "\tR" << (int) xi.rs << "\tR" << (int) xi.rt << endl;
+	}
+	cout << endl;
+#endif
+
+	prog -> halted = (xi.op == N_HALT);
+	*rec = traceRecord(xi);
+	(prog -> decoded)++;
+	return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+// //////////////////////////////////////////////////////////////////
+// File: xtrace.cpp
+// Description: Opcode table of the XSim instruction set modified
+//              for TomSim, shared by xsim and tomsim
+// //////////////////////////////////////////////////////////////////
+
+#include "xtrace.h"
+
+using namespace std;
+
+// Opcode descriptors, indexed by the 5-bit opcode field
+#define XR(op, unit) {op, XF_R, unit}
+#define XI(op, unit) {op, XF_I, unit}
+#define XRES {0, XF_RESERVED, IntUnit}
+#define XBAD {0, XF_INVALID, IntUnit}
+
+const XOpDesc xOpTable[X_OPCODES] = {
+    XR(N_ADD, IntUnit), XR(N_SUB, IntUnit), XR(N_AND, IntUnit), XR(N_NOR, IntUnit),		// 0x00
+    XR(N_DIV, DivUnit), XR(N_MUL, MultUnit), XR(N_MOD, DivUnit), XR(N_EXP, DivUnit),		// 0x04
+    XR(N_LW, LoadUnit), XR(N_SW, StoreUnit), XBAD, XBAD,					// 0x08
+    XRES, XR(N_HALT, IntUnit), XR(N_PUT, IntUnit), XBAD,					// 0x0C
+    XI(N_LIZ, IntUnit), XI(N_LIS, IntUnit), XI(N_LUI, IntUnit), XRES,				// 0x10
+    XRES, XRES, XRES, XRES,									// 0x14
+    XRES, XBAD, XBAD, XBAD,									// 0x18
+    XBAD, XBAD, XBAD, XBAD									// 0x1C
+};
+
@@ -0,0 +1,26 @@
+// //////////////////////////////////////////////////////////////////
+// File: lzpack.h
+// Description: Small LZ77 block codec for compressed traces. Each
+//		block is coded on its own, with no outside library.
+// //////////////////////////////////////////////////////////////////
+
+#ifndef _LZPack_
+#define _LZPack_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LZ_MIN_MATCH 4		// Shortest match coded
+#define LZ_MAX_OFFSET 65535	// Farthest match back
+#define LZ_HASH_BITS 14		// Match finder table size
+
+// Largest coded size of size input bytes
+inline size_t lzBound(size_t size) {
+    return size + (size / 255) + 16;
+}
+
+// Public Functions
+size_t lzCompress(const uint8_t * src, size_t size, uint8_t * dst);
+int lzDecompress(const uint8_t * src, size_t length, uint8_t * dst, size_t size);
+
+#endif
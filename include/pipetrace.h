@@ -0,0 +1,86 @@
+// //////////////////////////////////////////////////////////////////
+// File: pipetrace.h
+// Description: Binary pipeline event traces written by tomsim and
+//		read by ptrace. Events are buffered in memory and written
+//		in large blocks so recording long runs stays cheap.
+// //////////////////////////////////////////////////////////////////
+
+#ifndef _PipeTrace_
+#define _PipeTrace_
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Event trace identification
+#define PIPE_MAGIC "TOMP"
+#define PIPE_VERSION 2
+
+#define PIPE_LABEL 16		// Bytes per class label
+#define PIPE_BLOCK 65536	// Events buffered before a write
+
+// Pipeline events
+enum PipeEventType {PE_ISSUE, PE_READ, PE_EXEC, PE_WB, PE_STALL};
+
+// Header at the start of an event trace, followed by one label of
+// PIPE_LABEL bytes per FU class and then the events
+struct PipeHeader {
+    char magic[4];		// PIPE_MAGIC
+    uint32_t version;		// PIPE_VERSION
+    uint32_t numClasses;	// FU class labels after the header
+    uint32_t reserved;
+};
+
+// One pipeline event (24 bytes)
+struct PipeEvent {
+    uint64_t cycle;		// Clock cycle
+    uint32_t seq;		// Instruction number in the trace
+    uint32_t arg;		// Latency (exec) or cycles (stall)
+    uint16_t station;		// Station within the class
+    uint8_t type;		// PipeEventType
+    uint8_t unit;		// FU class
+    uint8_t op;			// Instruction_Name
+    uint8_t fu;			// Functional unit within the class (exec)
+    uint8_t pad[2];
+};
+
+// Buffered event writer
+struct PipeRecorder {
+    std::ofstream out;		// Output file
+    PipeEvent * ring;		// Buffered events
+    uint32_t count;		// Events in the buffer
+    uint64_t total;		// Events recorded
+};
+
+// Public Functions
+int openPipeRecorder(PipeRecorder * rec, const char * filename, const std::vector<std::string> & labels);
+void flushPipeRecorder(PipeRecorder * rec);
+void closePipeRecorder(PipeRecorder * rec);
+
+int readPipeHeader(std::istream & in, std::vector<std::string> * labels);
+
+// Append one event, writing the buffer when it fills
+inline void recordEvent(PipeRecorder * rec, int type, uint64_t cycle, uint32_t seq, int unit, int station, int op, int fu, uint32_t arg) {
+
+    PipeEvent * ev = &(rec -> ring[rec -> count]);
+
+    ev -> cycle = cycle;
+    ev -> seq = seq;
+    ev -> arg = arg;
+    ev -> station = station;
+    ev -> type = type;
+    ev -> unit = unit;
+    ev -> op = op;
+    ev -> fu = fu;
+    ev -> pad[0] = 0;
+    ev -> pad[1] = 0;
+
+    if (++(rec -> count) == PIPE_BLOCK) {
+	flushPipeRecorder(rec);
+    }
+
+    return;
+}
+
+#endif
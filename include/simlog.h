@@ -0,0 +1,38 @@
+// //////////////////////////////////////////////////////////////////
+// File: simlog.h
+// Description: Runtime log levels and categories for the simulator
+//		console output. Each message has a level and a category
+//		and is printed only when both are enabled.
+// //////////////////////////////////////////////////////////////////
+
+#ifndef _SimLog_
+#define _SimLog_
+
+// Levels, each includes the ones before it
+enum LogLevel {LOG_ERROR, LOG_INFO, LOG_DEBUG, LOG_TRACE};
+
+// Categories
+#define LOG_ISSUE	0x01	// Trace reading, issue and stalls
+#define LOG_RO		0x02	// Read operand
+#define LOG_EXEC	0x04	// Execution start and station dumps
+#define LOG_WB		0x08	// Writeback
+#define LOG_RENAME	0x10	// Register rename table
+#define LOG_CONFIG	0x20	// Configuration
+#define LOG_ALL		0x3F
+
+// Enabled output
+struct LogConfig {
+    int level = LOG_INFO;		// Highest level printed
+    unsigned mask = LOG_ALL;		// Categories printed
+};
+
+// True when a message of this level and category is printed
+inline int logOn(const LogConfig & log, int level, unsigned cat) {
+    return (level <= log.level) && (log.mask & cat);
+}
+
+// Public Functions
+int parseLogLevel(const char * name);
+int parseLogMask(const char * names, unsigned * mask);
+
+#endif
@@ -0,0 +1,137 @@
+// //////////////////////////////////////////////////////////////////
+// File: spscring.h
+// Description: Lock free ring connecting one producer thread to one
+//		consumer thread. Each side owns one index and keeps a
+//		cached copy of the other's, so the shared indices are
+//		only read when the cached copy says full or empty.
+// //////////////////////////////////////////////////////////////////
+
+#ifndef _SpscRing_
+#define _SpscRing_
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#define RING_LINE 64		// Bytes per cache line
+#define RING_SPIN 256		// Polls before yielding the core
+#define RING_NAP 4096		// Polls before a full ring sleeps between polls
+
+template <typename T>
+struct SpscRing {
+    std::vector<T> slots;		// Capacity is a power of two
+    uint64_t mask;			// Capacity - 1
+
+    // Consumer side
+    alignas(RING_LINE) std::atomic<uint64_t> head;	// Next slot to pop
+    uint64_t tailCache;					// Last tail seen
+
+    // Producer side
+    alignas(RING_LINE) std::atomic<uint64_t> tail;	// Next slot to push
+    uint64_t headCache;					// Last head seen
+
+    // Either side stops the other
+    alignas(RING_LINE) std::atomic<int> done;		// Producer finished
+    std::atomic<int> cancel;				// Consumer gave up
+};
+
+// Empty ring holding at least capacity items
+template <typename T>
+void initRing(SpscRing<T> * ring, uint64_t capacity) {
+
+    uint64_t size = 1;
+
+    while (size < capacity) {
+	size <<= 1;
+    }
+
+    ring -> slots.resize(size);
+    ring -> mask = size - 1;
+    ring -> head.store(0);
+    ring -> tail.store(0);
+    ring -> tailCache = 0;
+    ring -> headCache = 0;
+    ring -> done.store(0);
+    ring -> cancel.store(0);
+
+    return;
+}
+
+// Producer: add an item, waiting while the ring is full. Returns 0 if
+// the consumer cancelled.
+template <typename T>
+inline int ringPush(SpscRing<T> * ring, const T & item) {
+
+    uint64_t tail = ring -> tail.load(std::memory_order_relaxed);
+    int spin = 0;
+
+    while (tail - ring -> headCache > ring -> mask) {
+	ring -> headCache = ring -> head.load(std::memory_order_acquire);
+	if (tail - ring -> headCache <= ring -> mask) {
+	    break;
+	}
+	if (ring -> cancel.load(std::memory_order_relaxed)) {
+	    return 0;
+	}
+	// A consumer of large items takes a while to free a slot
+	if (++spin > RING_NAP) {
+	    std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+	else if (spin > RING_SPIN) {
+	    std::this_thread::yield();
+	}
+    }
+
+    ring -> slots[tail & ring -> mask] = item;
+    ring -> tail.store(tail + 1, std::memory_order_release);
+
+    return 1;
+}
+
+// Producer: no more items
+template <typename T>
+inline void ringFinish(SpscRing<T> * ring) {
+    ring -> done.store(1, std::memory_order_release);
+}
+
+// Consumer: take an item, waiting while the ring is empty. Returns 0
+// once the producer has finished and every item was taken.
+template <typename T>
+inline int ringPop(SpscRing<T> * ring, T * item) {
+
+    uint64_t head = ring -> head.load(std::memory_order_relaxed);
+    int spin = 0;
+
+    while (head == ring -> tailCache) {
+	ring -> tailCache = ring -> tail.load(std::memory_order_acquire);
+	if (head != ring -> tailCache) {
+	    break;
+	}
+	// Items pushed before done was set are visible once it is
+	if (ring -> done.load(std::memory_order_acquire)) {
+	    ring -> tailCache = ring -> tail.load(std::memory_order_acquire);
+	    if (head == ring -> tailCache) {
+		return 0;
+	    }
+	    break;
+	}
+	if (++spin > RING_SPIN) {
+	    std::this_thread::yield();
+	}
+    }
+
+    *item = ring -> slots[head & ring -> mask];
+    ring -> head.store(head + 1, std::memory_order_release);
+
+    return 1;
+}
+
+// Consumer: stop the producer, which may be waiting on a full ring
+template <typename T>
+inline void ringCancel(SpscRing<T> * ring) {
+    ring -> cancel.store(1, std::memory_order_relaxed);
+}
+
+#endif
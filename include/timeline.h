@@ -0,0 +1,158 @@
+// //////////////////////////////////////////////////////////////////
+// File: timeline.h
+// Description: Per instruction timelines written by tomsim and read
+//		by tquery. Each issued instruction gets one row with the
+//		cycles it passed each stage. Rows are stored by column in
+//		groups of TL_GROUP rows, so a slice of a long run can be
+//		read without reading the rest.
+// //////////////////////////////////////////////////////////////////
+
+#ifndef _Timeline_
+#define _Timeline_
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Timeline identification
+#define TL_MAGIC "TOML"
+#define TL_VERSION 2
+
+#define TL_LABEL 16		// Bytes per class label
+#define TL_GROUP 65536		// Rows per column group
+
+// Columns, stored in this order within each group
+enum TimelineField {TL_SEQ, TL_ISSUE, TL_READ, TL_EXEC, TL_DONE, TL_WB, TL_STATION, TL_FU, TL_OP, TL_UNIT, TL_NUM};
+
+extern const char * timelineNames[TL_NUM];
+extern const int timelineWidth[TL_NUM];
+
+// Header at the start of a timeline, followed by one label of TL_LABEL
+// bytes per FU class and then the groups. A group is its row count
+// (uint32) and then each column for those rows. Every group but the
+// last holds TL_GROUP rows.
+struct TimelineHeader {
+    char magic[4];		// TL_MAGIC
+    uint32_t version;		// TL_VERSION
+    uint32_t numClasses;	// FU class labels after the header
+    uint32_t groupRows;		// TL_GROUP
+};
+
+// One issued instruction
+struct TimelineRow {
+    uint32_t seq;		// Instruction number in the trace
+    uint64_t issue;		// Issue cycle
+    uint64_t read;		// Read operand cycle
+    uint64_t exec;		// Execution start cycle
+    uint64_t done;		// Last execution cycle
+    uint64_t wb;		// Writeback cycle
+    uint16_t station;		// Station within the class
+    uint16_t fu;		// Functional unit within the class
+    uint8_t op;			// Instruction_Name
+    uint8_t unit;		// FU class
+    uint8_t complete;		// Written back
+};
+
+// Timeline writer. Rows are created in issue order and completed out
+// of order, so rows in flight wait in a ring until all older rows
+// have written back. One slow row holds back every younger one, so
+// the ring doubles whenever it is full.
+struct TimelineWriter {
+    std::ofstream out;			// Output file
+    std::vector<TimelineRow> ring;	// Rows in flight
+    uint64_t mask;			// Ring size - 1
+    uint64_t head;			// Oldest row in flight
+    uint64_t tail;			// Next row
+    std::vector<int64_t> row;		// Row of each station, -1 if none
+    std::vector<TimelineRow> group;	// Finished rows not yet written
+    std::vector<char> buffer;		// Group in column order
+    uint64_t total;			// Rows written
+};
+
+// Timeline reader
+struct TimelineReader {
+    std::ifstream in;			// Input file
+    std::vector<std::string> labels;	// FU class labels
+    uint64_t rows;			// Rows in the file
+    uint32_t groupRows;			// Rows per full group
+    uint64_t start;			// Offset of the first group
+};
+
+// Public Functions
+int openTimeline(TimelineWriter * tl, const char * filename, const std::vector<std::string> & labels, int stations);
+void growTimeline(TimelineWriter * tl);
+void retireTimeline(TimelineWriter * tl);
+void closeTimeline(TimelineWriter * tl);
+
+int openTimelineReader(TimelineReader * tr, const char * filename);
+int readTimelineGroup(TimelineReader * tr, uint64_t group, std::vector<TimelineRow> * rows);
+uint64_t timelineValue(const TimelineRow & row, int field);
+
+// A station issued an instruction
+inline void timelineIssue(TimelineWriter * tl, int station, uint32_t seq, int op, int unit, int index, uint64_t cycle) {
+
+    TimelineRow * r;
+
+    if (tl -> tail - tl -> head > tl -> mask) {
+	growTimeline(tl);
+    }
+
+    tl -> row[station] = tl -> tail;
+    r = &(tl -> ring[tl -> tail & tl -> mask]);
+    r -> seq = seq;
+    r -> issue = cycle;
+    r -> read = 0;
+    r -> exec = 0;
+    r -> done = 0;
+    r -> wb = 0;
+    r -> station = index;
+    r -> fu = 0;
+    r -> op = op;
+    r -> unit = unit;
+    r -> complete = 0;
+    (tl -> tail)++;
+
+    return;
+}
+
+inline void timelineRead(TimelineWriter * tl, int station, uint64_t cycle) {
+
+    if (tl -> row[station] >= 0) {
+	tl -> ring[tl -> row[station] & tl -> mask].read = cycle;
+    }
+
+    return;
+}
+
+inline void timelineExec(TimelineWriter * tl, int station, uint64_t cycle, int latency, int fu) {
+
+    TimelineRow * r;
+
+    if (tl -> row[station] >= 0) {
+	r = &(tl -> ring[tl -> row[station] & tl -> mask]);
+	r -> exec = cycle;
+	r -> done = cycle + latency;
+	r -> fu = fu;
+    }
+
+    return;
+}
+
+// The station wrote back, its row and any younger finished rows can go
+inline void timelineWriteback(TimelineWriter * tl, int station, uint64_t cycle) {
+
+    TimelineRow * r;
+
+    if (tl -> row[station] >= 0) {
+	r = &(tl -> ring[tl -> row[station] & tl -> mask]);
+	r -> wb = cycle;
+	r -> complete = 1;
+	tl -> row[station] = -1;
+	retireTimeline(tl);
+    }
+
+    return;
+}
+
+#endif
@@ -0,0 +1,256 @@
+// //////////////////////////////////////////////////////////////////
+// File: tomsim.h
+// Description: Simulator state for one run of Tomasulo's algorithm.
+//		Everything a run changes lives in a Simulator, so several
+//		runs can share a trace and execute on separate threads.
+// //////////////////////////////////////////////////////////////////
+
+#ifndef _TomSim_
+#define _TomSim_
+
+#include <stdint.h>
+#include <time.h>
+#include <signal.h>
+#include <string>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <thread>
+#include <jsoncpp/json/json.h>
+
+#include "tracefile.h"
+#include "simlog.h"
+#include "pipetrace.h"
+#include "timeline.h"
+#include "spscring.h"
+#include "xprog.h"
+
+#define NUMREGS 8
+#define FILE_SIZE 300
+#define INST_WINDOW 64	// Upcoming instructions held in memory
+#define FEED_RING 65536	// Decoded instructions between xsim and tomsim
+
+// Producer tags are the station table index plus one. Values read from
+// the register file carry the register number with TAG_REGFILE set.
+typedef uint32_t rstag;
+
+#define TAG_READY 0		// Operand available, register not renamed
+#define TAG_REGFILE 0x80000000	// Value read from the register file
+
+// FU class descriptor, read from the configuration file
+struct FUClass {
+    std::string name;		// Configuration key
+    std::string label;		// Name in console output
+    std::string tag;		// Tag prefix in station dumps
+    int number = 0;		// Number of functional units
+    int resnumber = 0;		// Number of reservation stations
+    int latency = 0;		// Execution cycles
+    int ii = 0;			// Cycles between starts, 0 if busy until writeback
+    int base = 0;		// First station in the station table
+    int fubase = 0;		// First unit in the FU table
+    int busy = 0;		// Occupied stations
+};
+
+// Reservation stations of every class as a structure of arrays. Each
+// class owns [base, base + resnumber), with base aligned to a bitmask
+// word so allocation stays within the class's own words.
+struct StationTable {
+    int size = 0;			// Stations including alignment padding
+    std::vector<uint8_t> busy;		// Reservation station occupied
+    std::vector<int> execycles;		// Number of execution cycles remaining
+    std::vector<uint64_t> age;		// When instruction was issued
+    std::vector<uint64_t> startexe;	// When instruction began execution, 0 if not yet
+    std::vector<uint64_t> ready;	// When all operands were available
+    std::vector<int> funit;		// Which function unit instruction has been assigned
+    std::vector<int> unit;		// FU class of the station
+    std::vector<int> op;		// Reservation Station Data (Instruction_Name)
+    std::vector<uint32_t> seq;		// Instruction number in the trace
+    std::vector<rstag> vj;		// Source of first operand value
+    std::vector<rstag> vk;		// Source of second operand value
+    std::vector<rstag> qj;		// Producer of first operand
+    std::vector<rstag> qk;		// Producer of second operand
+    std::vector<int> dest;		// Register renamed to this station
+    std::vector<uint64_t> busymask;	// Occupied stations, one bit each
+};
+
+// Window slot for instruction info, decoded when read from the trace
+struct instNode {
+    uint32_t seq;		// Instruction number in the trace
+    uint16_t funit;		// Which FU class executes it
+    uint8_t opcode;		// Instruction_Name
+    int8_t dest;		// Register written, -1 for none
+    int8_t src[2];		// Registers read into j and k, -1 for none
+    uint8_t imm8;		// Immediate of LIZ, LIS and LUI
+};
+
+// Consumer operand waiting on a producer station
+struct waiter {
+    int station;		// Waiting station
+    int operand;		// 0 for j, 1 for k
+};
+
+// Functional Unit Info
+struct FUInfo {
+    int inUse = 0;	// FU executing
+    int count = 0;	// Number of instruction executed
+    uint64_t start = 0;		// Cycle the current instruction started
+    uint64_t nextFree = 0;	// Cycle a pipelined unit accepts again
+    uint64_t busyCycles = 0;	// Cycles the unit could not accept
+};
+
+// Stations ready to execute, oldest first
+typedef std::pair<uint64_t, int> readyEntry;
+typedef std::priority_queue<readyEntry, std::vector<readyEntry>, std::greater<readyEntry> > readyQueue;
+
+// Host time charged to each part of a run
+enum ProfPhase {PROF_LOAD, PROF_CONFIG, PROF_SKIP, PROF_READ, PROF_WB, PROF_CHECKFU, PROF_ISSUE, PROF_EXEC, PROF_FINISH, PROF_RESULTS, PROF_NUM};
+
+// Self profile of a run. Load, configuration, simulate and results are
+// always timed; the pipeline phases only when phases is set, since that
+// reads the clock several times per simulated cycle.
+struct Profile {
+    int phases = 0;			// Time each pipeline phase
+    uint64_t ns[PROF_NUM] = {};		// Host nanoseconds per phase
+    uint64_t simulate = 0;		// Host nanoseconds in simulate
+    uint64_t mark = 0;			// Start of the current phase
+    uint64_t nested = 0;		// Trace reading inside the current phase
+};
+
+// Host clock in nanoseconds
+inline uint64_t profNow() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t) ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+// Charge the time since the last mark to a phase
+inline void profCharge(Profile * prof, int phase) {
+
+    uint64_t now = profNow();
+
+    prof -> ns[phase] += (now - prof -> mark) - prof -> nested;
+    prof -> mark = now;
+    prof -> nested = 0;
+
+    return;
+}
+
+// Sampled simulation. Each period starts with warmup instructions in
+// detail, then detail measured instructions, then fast forwards the rest.
+struct SampleConfig {
+    int detail = 0;		// Measured instructions per period, 0 when off
+    int warmup = 0;		// Detailed but unmeasured instructions
+    uint64_t period = 0;	// Instructions per period
+};
+
+// xsim program decoded by a producer thread
+struct XFeed {
+    XProgram prog;			// Program being decoded
+    SpscRing<TraceRecord> ring;		// Decoded instructions
+    std::thread producer;		// Decoder thread
+};
+
+// One simulation run
+struct Simulator {
+    // Options
+    int eventDriven = 0;	// Skip cycles in which nothing can change
+    LogConfig log;		// Console output
+    PipeRecorder * recorder = NULL;	// Pipeline events, NULL when off
+    TimelineWriter * timeline = NULL;	// Instruction timelines, NULL when off
+    Profile profile;		// Host time
+
+    // Configuration
+    std::vector<FUClass> fuclass;	// All FU classes
+    int opclass[TRACE_NUM_OPS];		// Class executing each instruction
+    int cdbWidth = 0;			// Broadcasts per cycle, 0 for unlimited
+
+    // Statistics
+    uint64_t numInst = 0;	// Number of instructions read from trace
+    uint64_t stalls = 0;	// Number of pipeline stalls
+    uint64_t regreads = 0;	// Number of register reads
+    uint64_t clockcycles = 0;	// Number of clock cycles
+    int keepIssue = 1;		// Flag for halt
+
+    // Read operand, carried from one cycle to the next
+    int allowRO = 0;		// Instruction waiting for read operand
+    int roSlot = 0;		// Its window slot
+    int roStation = -1;		// Its reservation station
+
+    // Machine state
+    rstag renamereg[NUMREGS];			// Array of renamed registers
+    StationTable rs;				// Reservation stations
+    int busyStations = 0;			// Occupied stations in all classes
+    std::vector< std::vector<waiter> > waitlist;// Waiting consumers of each station
+    std::vector<readyQueue> readyq;		// Ready stations per class
+    std::vector<FUInfo> fus;			// Units of all classes
+    std::vector<int> finished;			// Stations waiting for the CDB
+
+    // Cycle attribution per FU class
+    std::vector<uint64_t> issueStalls;	// Issue stalled on full stations
+    std::vector<uint64_t> operandWait;	// Station cycles waiting on a producer class
+    std::vector<uint64_t> unitWait;	// Ready station cycles waiting for a unit
+
+    // Common data bus
+    uint64_t cdbWait = 0;		// Station cycles spent waiting for a bus
+    uint64_t cdbContention = 0;		// Cycles with more finishers than buses
+    std::vector<uint64_t> cdbHist;	// Cycles by number of broadcasts
+
+    // Bounded window of upcoming instructions, refilled from the trace
+    instNode instWindow[INST_WINDOW];
+    int windowHead = 0;		// Oldest instruction not yet issued
+    int windowCount = 0;	// Instructions in the window
+    int traceDone = 0;		// HALT or end of trace reached
+
+    // Trace input, either streamed or shared with other runs
+    TraceReader * reader = NULL;		// Streaming input
+    const TraceRecord * records = NULL;		// Shared read only records
+    uint64_t numRecords = 0;			// Shared record count
+    uint64_t tracePos = 0;			// Next shared record
+    uint64_t traceRead = 0;			// Records read from either input
+    XFeed * feed = NULL;			// Records decoded in process
+    TraceRecord feedRecord;			// Last record taken from the feed
+
+    // Sampled simulation
+    SampleConfig sample;		// Sampling periods
+    uint64_t samplePos = 0;		// Instructions issued in this period
+    uint64_t sampleStart = 0;		// Cycle the measured part started
+    uint64_t sampleStalls = 0;		// Stalls when the measured part started
+    uint64_t skipped = 0;		// Instructions fast forwarded
+    std::vector<double> cpiSamples;	// Cycles per instruction of each sample
+    std::vector<double> spiSamples;	// Stalls per instruction of each sample
+
+    // Checkpoints
+    const char * checkpointFile = NULL;	// Checkpoint written here
+    uint64_t checkpointInterval = 0;	// Cycles between checkpoints, 0 for none
+    uint64_t nextCheckpoint = 0;	// Cycle of the next periodic checkpoint
+    int stopped = 0;			// Stopped early after a checkpoint
+};
+
+// Checkpoint requests from signal handlers
+enum CheckpointRequest {CKPT_NONE, CKPT_SAVE, CKPT_STOP};
+extern volatile sig_atomic_t checkpointSignal;
+
+// Public Functions
+int readConfig(Simulator * sim, const char * filename);
+int parseConfig(Simulator * sim, const Json::Value & root);
+void initStations(Simulator * sim);
+uint64_t simulate(Simulator * sim);
+void printFU(Simulator * sim);
+Json::Value makeResults(Simulator * sim);
+void writeResults(Simulator * sim, const char * filename);
+
+int saveCheckpoint(Simulator * sim, const char * filename);
+int loadCheckpoint(Simulator * sim, const char * filename);
+
+XFeed * newFeed();
+void deleteFeed(XFeed * feed);
+int loadFeed(XFeed * feed, const char * filename);
+void startFeed(XFeed * feed);
+void stopFeed(XFeed * feed);
+
+int runSweep(const char * tracename, const char * sweepname, const char * outname, int threads, int eventDriven, int phases, const SampleConfig & sample, const char * restore);
+
+#endif
@@ -0,0 +1,272 @@
+// //////////////////////////////////////////////////////////////////
+// File: tracefile.h
+// Description: Trace file formats shared by xsim, tomsim and tconv.
+//		Traces are text (one instruction per line), binary
+//		(fixed width records behind a small header) or packed
+//		(binary records in independently compressed blocks).
+// //////////////////////////////////////////////////////////////////
+
+#ifndef _TraceFile_
+#define _TraceFile_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "xtrace.h"
+#include "spscring.h"
+
+// Binary trace identification
+#define TRACE_MAGIC "TOMT"
+#define TRACE_VERSION 1
+
+// Trace writer buffers, one filled while the other is written
+#define TRACE_BUFFER (1 << 20)	// Bytes per buffer
+#define TRACE_LINE 32		// Longest text record
+
+// Least text per parsing thread when a text trace is loaded whole
+#define TRACE_CHUNK (1 << 22)
+
+// Packed trace identification
+#define PACK_MAGIC "TOMZ"
+#define PACK_VERSION 1
+#define PACK_BLOCK (TRACE_BUFFER / sizeof(TraceRecord))	// Records per block
+#define PACK_AHEAD 4		// Blocks decompressed ahead of the reader
+
+// Trace formats
+enum TraceFormat {TRACE_TEXT, TRACE_BINARY, TRACE_PACKED};
+
+// Number of instruction names in Instruction_Name
+#define TRACE_NUM_OPS (N_PUT + 1)
+
+// Header at the start of a binary trace
+struct TraceHeader {
+    char magic[4];		// TRACE_MAGIC
+    uint32_t version;		// TRACE_VERSION
+    uint64_t count;		// Number of records after the header
+};
+
+// One dynamic instruction (4 bytes)
+struct TraceRecord {
+    uint8_t op;			// Instruction_Name
+    uint8_t rd;			// Destination register
+    uint8_t rs;			// First source register
+    union {
+	uint8_t rt;		// Second source register (R-Type)
+	uint8_t imm8;		// Immediate (LIZ, LIS, LUI)
+    };
+};
+
+// Header at the start of a packed trace. The index is written
+// after the last block, once the block sizes are known.
+struct PackHeader {
+    char magic[4];		// PACK_MAGIC
+    uint32_t version;		// PACK_VERSION
+    uint64_t count;		// Number of records
+    uint32_t blockRecords;	// Records per block, all but the last are full
+    uint32_t blocks;		// Number of blocks
+    uint64_t index;		// File offset of the block index
+};
+
+// Block index entry. A block holds its records column by column
+// (all opcodes, then all rd, rs and rt bytes), coded with lzpack.
+struct PackBlock {
+    uint64_t offset;		// File offset of the coded block
+    uint32_t length;		// Coded length
+    uint32_t records;		// Records in the block
+};
+
+// Trace record of a decoded instruction. Only the fields the text
+// format carries are kept, so the binary record of an instruction is
+// the same whether it was decoded or converted from text.
+inline TraceRecord traceRecord(const XInst & xi) {
+
+    TraceRecord rec;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.op = xi.op;
+
+    switch (xi.op) {
+	case (N_LW):
+	    rec.rd = xi.rd;
+	    rec.rs = xi.rs;
+	    break;
+	case (N_SW):
+	    rec.rt = xi.rt;
+	    rec.rs = xi.rs;
+	    break;
+	case (N_LIZ):
+	case (N_LIS):
+	case (N_LUI):
+	    rec.rd = xi.rd;
+	    rec.imm8 = xi.imm8;
+	    break;
+	case (N_PUT):
+	    rec.rs = xi.rs;
+	    break;
+	case (N_HALT):
+	    break;
+	default:
+	    rec.rd = xi.rd;
+	    rec.rs = xi.rs;
+	    rec.rt = xi.rt;
+	    break;
+    }
+
+    return rec;
+}
+
+// Trace writer for either format. Records are formatted into one
+// buffer while a background thread writes the other to the file.
+struct TraceWriter {
+    int fd;				// Output file
+    int binary;				// Writing binary records
+    int packed;				// Compressing blocks of records
+    uint64_t count;			// Records written
+    uint64_t bytes;			// Bytes written, header included
+    std::vector<char> buffer[2];	// Double buffer
+    int fill;				// Buffer being filled
+    size_t used;			// Bytes in the filled buffer
+    size_t limit;			// Hand the buffer over past this
+
+    // Shared with the writer thread
+    std::thread thread;			// Writes full buffers
+    std::mutex lock;
+    std::condition_variable wake;
+    size_t pending;			// Bytes of the other buffer to write
+    int closing;			// No more buffers
+    int failed;				// A write failed
+
+    uint64_t waitNs;			// Time spent waiting for the thread
+
+    // Packed output, used by the writer thread only
+    std::vector<uint8_t> columns;	// Block reordered by column
+    std::vector<uint8_t> coded;		// Compressed block
+    std::vector<PackBlock> index;	// Blocks written
+};
+
+// Read only mapping of a binary trace
+struct MappedTrace {
+    int fd;			// File descriptor
+    size_t length;		// Mapped length
+    void * base;		// Start of mapping
+    const TraceRecord * records;// First record
+    uint64_t count;		// Number of records
+};
+
+// Read only mapping of a packed trace
+struct PackedTrace {
+    int fd;			// File descriptor
+    size_t length;		// Mapped length
+    void * base;		// Start of mapping
+    const PackHeader * header;	// Header
+    const PackBlock * index;	// Block index
+    uint64_t count;		// Number of records
+};
+
+// Packed trace read in order. A helper thread decompresses the next
+// blocks into slots and passes them over in a ring.
+struct PackedStream {
+    PackedTrace trace;				// Input
+    std::vector<TraceRecord> slots[PACK_AHEAD + 2];	// Decompressed blocks
+    SpscRing<int> ready;			// Filled slots in block order
+    std::thread helper;				// Decompresses ahead
+    std::vector<uint8_t> columns;		// Helper scratch block
+    std::atomic<int> damaged;			// A block failed to decode
+    uint64_t start;				// Record the helper starts at
+    uint64_t first;				// First block the helper decodes
+    int slot;					// Slot being read, -1 for none
+    size_t pos;					// Next record in the slot
+    size_t skip;				// Records to skip in the first block
+};
+
+// Sequential reader for any format
+struct TraceReader {
+    int binary;			// Reading a mapped binary trace
+    int packed;			// Reading a packed trace
+    std::ifstream text;		// Text input
+    MappedTrace mapped;		// Binary input
+    PackedStream stream;	// Packed input
+    uint64_t pos;		// Next binary record
+    TraceRecord scratch;	// Last text record
+};
+
+// Whole trace in memory, read only once loaded. Binary traces stay
+// mapped, text and packed traces are decoded into records.
+struct TraceStore {
+    MappedTrace mapped;			// Binary input
+    std::vector<TraceRecord> parsed;	// Text input
+    const TraceRecord * records;	// First record
+    uint64_t count;			// Number of records
+};
+
+// Public Functions
+const char * traceOpName(int op);
+int traceOpCode(const std::string & name);
+int traceFileIsBinary(const char * filename);
+int traceFileFormat(const char * filename);
+
+int readTextRecord(std::istream & in, TraceRecord * rec);
+int formatTextRecord(char * line, const TraceRecord & rec);
+void writeTextRecord(std::ostream & out, const TraceRecord & rec);
+
+int openTraceWriter(TraceWriter * writer, const char * filename, int format);
+void flushTraceBuffer(TraceWriter * writer);
+int closeTraceWriter(TraceWriter * writer);
+
+int mapTrace(const char * filename, MappedTrace * trace);
+void unmapTrace(MappedTrace * trace);
+
+int openTraceReader(TraceReader * reader, const char * filename);
+const TraceRecord * readTrace(TraceReader * reader);
+int seekTrace(TraceReader * reader, uint64_t record);
+void closeTraceReader(TraceReader * reader);
+
+int startPackedTrace(TraceWriter * writer);
+int writePackedBlock(TraceWriter * writer, const char * data, size_t length);
+int finishPackedTrace(TraceWriter * writer);
+
+int mapPackedTrace(const char * filename, PackedTrace * trace);
+void unmapPackedTrace(PackedTrace * trace);
+int unpackBlock(const PackedTrace * trace, uint64_t block, std::vector<TraceRecord> * records, std::vector<uint8_t> * columns);
+
+int openPackedStream(PackedStream * stream, const char * filename);
+const TraceRecord * readPacked(PackedStream * stream);
+int seekPacked(PackedStream * stream, uint64_t record);
+void closePackedStream(PackedStream * stream);
+
+int parseTextTrace(const char * filename, std::vector<TraceRecord> * records, int threads);
+int loadTraceStore(TraceStore * store, const char * filename, int threads);
+void freeTraceStore(TraceStore * store);
+
+// Append one instruction to the trace
+inline void writeTrace(TraceWriter * writer, const TraceRecord & rec) {
+
+    char * end;
+
+    if (writer -> used > writer -> limit) {
+	flushTraceBuffer(writer);
+    }
+
+    end = &(writer -> buffer[writer -> fill][writer -> used]);
+    if (writer -> binary) {
+	memcpy(end, &rec, sizeof(rec));
+	writer -> used += sizeof(rec);
+    }
+    else {
+	writer -> used += formatTextRecord(end, rec);
+    }
+
+    (writer -> count)++;
+
+    return;
+}
+
+#endif
@@ -0,0 +1,26 @@
+// //////////////////////////////////////////////////////////////////
+// File: xprog.h
+// Description: XSim programs decoded straight to trace records, so a
+//		program can feed tomsim without writing a trace file
+// //////////////////////////////////////////////////////////////////
+
+#ifndef _XProg_
+#define _XProg_
+
+#include <stdint.h>
+
+#include "tracefile.h"
+
+// Program being decoded
+struct XProgram {
+    unsigned char memory[MEM_SIZE];	// Instruction memory
+    uint16_t pc;			// Program counter
+    int halted;				// HALT decoded
+    uint64_t decoded;			// Records produced
+};
+
+// Public Functions
+int loadProgram(XProgram * prog, const char * filename);
+int decodeNext(XProgram * prog, TraceRecord * rec);
+
+#endif
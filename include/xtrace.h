@@ -10,6 +10,7 @@
 // Define size of memory
 #define MEM_SIZE 65536
 
+#include <stdint.h>
 #include <cstring>
 #include <getopt.h>
 #include <stdio.h>
@@ -22,32 +23,60 @@
 #include <jsoncpp/json/writer.h>
 
 // Uncomment for more output to terminal
-#define DEBUG
+// #define DEBUG
 
 // Create enumerated types for instructions
 enum Latency {ADD, SUB, AND, NOR, DIV, MUL, MOD, EXP};
 enum Instruction_Name {N_ADD, N_SUB, N_AND, N_NOR, N_DIV, N_MUL, N_MOD, N_EXP, N_LW, N_SW, N_LIZ, N_LIS, N_LUI, N_HALT, N_PUT};
 
-// Public Functions
-void get_opcode(unsigned short int inst, unsigned short int * op);
-void r_type_field(short int inst, std::string * rd, std::string * rs, std::string * rt);
-void i_type_field(short int inst, std::string * rd, short int * imm8);
-void ix_type_field(short int inst, int * imm11);
-
-short int x_add(short int inst, std::string * rd, std::string * rs, std::string * rt);
-short int x_sub(short int inst, std::string * rd, std::string * rs, std::string * rt);
-short int x_and(short int inst, std::string * rd, std::string * rs, std::string * rt);
-short int x_nor(short int inst, std::string * rd, std::string * rs, std::string * rt);
-short int x_div(short int inst, std::string * rd, std::string * rs, std::string * rt);
-short int x_mul(short int inst, std::string * rd, std::string * rs, std::string * rt);
-short int x_mod(short int inst, std::string * rd, std::string * rs, std::string * rt);
-short int x_exp(short int inst, std::string * rd, std::string * rs, std::string * rt);
-short int x_lw(short int inst, std::string * rd, std::string * rs, std::string * rt);
-short int x_sw(short int inst, std::string * rd, std::string * rs, std::string * rt);
-short int x_liz(short int inst, std::string * rd, short int * imm8);
-short int x_lis(short int inst, std::string * rd, short int * imm8);
-short int x_lui(short int inst, std::string * rd, short int * imm8);
-short int x_halt(short int inst, std::string * rd, std::string * rs, std::string * rt);
-short int x_put(short int inst, std::string * rd, std::string * rs, std::string * rt);
+// Built in FU classes, the default class of each instruction
+enum FUnits {IntUnit, DivUnit, MultUnit, LoadUnit, StoreUnit, NumBuiltin};
+
+// Instruction formats. Reserved opcodes are skipped quietly, invalid
+// ones are reported.
+enum XFormat {XF_INVALID, XF_RESERVED, XF_R, XF_I};
+
+#define X_OPCODES 32		// 5-bit opcode field
+
+// What an opcode decodes to
+struct XOpDesc {
+    uint8_t op;			// Instruction_Name
+    uint8_t format;		// XFormat
+    uint8_t unit;		// Default FU class
+};
+
+// Decoded instruction, plain data with register numbers as indices
+struct XInst {
+    uint8_t op;			// Instruction_Name
+    uint8_t format;		// XFormat
+    uint8_t unit;		// Default FU class
+    uint8_t rd;			// Destination register
+    uint8_t rs;			// First source register
+    uint8_t rt;			// Second source register (R-Type)
+    uint8_t imm8;		// Immediate (I-Type)
+};
+
+extern const XOpDesc xOpTable[X_OPCODES];
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: One 16-bit instruction
+// Outputs: 1 and the decoded instruction, 0 for reserved and invalid
+//		opcodes
+// /////////////////////////////////////////////////////////////////
+inline int decodeInst(uint16_t inst, XInst * xi) {
+
+    const XOpDesc & desc = xOpTable[(inst >> 11) & 0x1F];
+    int rtype = (desc.format == XF_R);
+
+    xi -> op = desc.op;
+    xi -> format = desc.format;
+    xi -> unit = desc.unit;
+    xi -> rd = (inst >> 8) & 0x07;
+    xi -> rs = rtype ? (inst >> 5) & 0x07 : 0;
+    xi -> rt = rtype ? (inst >> 2) & 0x07 : 0;
+    xi -> imm8 = (desc.format == XF_I) ? inst & 0xFF : 0;
+
+    return (desc.format >= XF_R);
+}
 
 #endif
@@ -0,0 +1,257 @@
+// ////////////////////////////////////////////////////////
+// File: ptrace.cpp
+// Description: Converts pipeline event traces recorded by
+//		tomsim -r to Chrome trace event JSON or to
+//		the Konata pipeline viewer format
+// ////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <unistd.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "pipetrace.h"
+#include "tracefile.h"
+
+using namespace std;
+
+// Instruction in flight
+struct InFlight {
+    uint64_t issue;		// Issue cycle
+    uint64_t read;		// Read operand cycle
+    uint64_t exec;		// Execution start cycle
+    int started;		// Execution started
+};
+
+// Chrome trace thread of a station or functional unit
+int chromeThread(int unit, int index, int isFU) {
+    return ((unit + 1) * 1000) + (isFU ? 0 : 500) + index;
+}
+
+// Name a Chrome trace thread
+void chromeName(ostream & out, int * first, int tid, const string & name) {
+
+    out << (*first ? "" : ",\n") << "{\"ph\":\"M\",\"pid\":0,\"tid\":" << tid << ",\"name\":\"thread_name\",\"args\":{\"name\":\"" << name << "\"}}";
+    *first = 0;
+
+    return;
+}
+
+// One complete event on a Chrome trace thread
+void chromeSpan(ostream & out, int * first, int tid, const string & name, uint64_t start, uint64_t end, uint32_t seq) {
+
+    out << (*first ? "" : ",\n") << "{\"ph\":\"X\",\"pid\":0,\"tid\":" << tid << ",\"name\":\"" << name << "\",\"ts\":" << start << ",\"dur\":" << end - start << ",\"args\":{\"seq\":" << seq << "}}";
+    *first = 0;
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Description: One thread per station and functional unit. Stations
+//		show issue to execution start, units show execution to
+//		writeback. One time unit is one clock cycle.
+// /////////////////////////////////////////////////////////////////
+void writeChrome(istream & in, ostream & out, const vector<string> & labels) {
+
+    unordered_map<uint32_t, InFlight> flight;
+    unordered_map<uint32_t, InFlight>::iterator found;
+    vector< vector<int> > named(labels.size() * 2);
+    PipeEvent ev;
+    InFlight * f;
+    string name;
+    int first = 1;
+    int tid;
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+    chromeName(out, &first, 0, "Issue stalls");
+
+    while (in.read((char *) &ev, sizeof(ev))) {
+	name = string(traceOpName(ev.op)) + " " + to_string(ev.seq);
+
+	// Events of an instruction issued before the recording are skipped
+	found = flight.find(ev.seq);
+	if ((ev.type != PE_ISSUE) && (ev.type != PE_STALL) && (found == flight.end())) {
+	    continue;
+	}
+
+	switch (ev.type) {
+	    case (PE_ISSUE):
+		f = &flight[ev.seq];
+		f -> issue = ev.cycle;
+		f -> read = ev.cycle;
+		f -> exec = ev.cycle;
+		f -> started = 0;
+		break;
+	    case (PE_READ):
+		found -> second.read = ev.cycle;
+		break;
+	    case (PE_EXEC):
+		f = &(found -> second);
+		f -> exec = ev.cycle;
+		f -> started = 1;
+		tid = chromeThread(ev.unit, ev.station, 0);
+		if (named[ev.unit * 2].size() <= ev.station) {
+		    named[ev.unit * 2].resize(ev.station + 1, 0);
+		}
+		if (!named[ev.unit * 2][ev.station]) {
+		    chromeName(out, &first, tid, labels[ev.unit] + " station " + to_string(ev.station));
+		    named[ev.unit * 2][ev.station] = 1;
+		}
+		chromeSpan(out, &first, tid, name, f -> issue, ev.cycle, ev.seq);
+		break;
+	    case (PE_WB):
+		f = &(found -> second);
+		tid = chromeThread(ev.unit, ev.fu, 1);
+		if (named[ev.unit * 2 + 1].size() <= ev.fu) {
+		    named[ev.unit * 2 + 1].resize(ev.fu + 1, 0);
+		}
+		if (!named[ev.unit * 2 + 1][ev.fu]) {
+		    chromeName(out, &first, tid, labels[ev.unit] + "Unit " + to_string(ev.fu + 1));
+		    named[ev.unit * 2 + 1][ev.fu] = 1;
+		}
+		chromeSpan(out, &first, tid, name, f -> exec, ev.cycle, ev.seq);
+		flight.erase(found);
+		break;
+	    case (PE_STALL):
+		chromeSpan(out, &first, 0, "Stall " + name, ev.cycle, ev.cycle + ev.arg, ev.seq);
+		break;
+	}
+    }
+
+    out << "\n]}\n";
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Description: Konata log with the stages Is (issue), Rd (read
+//		operand and wait), Ex (execute) and Wb (writeback)
+// /////////////////////////////////////////////////////////////////
+void writeKonata(istream & in, ostream & out, const vector<string> & labels) {
+
+    unordered_set<uint32_t> flight;
+    vector<uint32_t> retiring;
+    PipeEvent ev;
+    uint64_t cycle = 0;
+    uint64_t retired = 0;
+
+    out << "Kanata\t0004\n";
+    out << "C=\t0\n";
+
+    while (in.read((char *) &ev, sizeof(ev))) {
+	// Advance the clock, finished instructions leave the pipeline
+	if (ev.cycle > cycle) {
+	    out << "C\t" << ev.cycle - cycle << "\n";
+	    cycle = ev.cycle;
+	    for (size_t i = 0; i < retiring.size(); ++i) {
+		out << "R\t" << retiring[i] << "\t" << retired++ << "\t0\n";
+	    }
+	    retiring.clear();
+	}
+
+	// Events of an instruction issued before the recording are skipped
+	if ((ev.type != PE_ISSUE) && (ev.type != PE_STALL) && (flight.count(ev.seq) == 0)) {
+	    continue;
+	}
+
+	switch (ev.type) {
+	    case (PE_ISSUE):
+		flight.insert(ev.seq);
+		out << "I\t" << ev.seq << "\t" << ev.seq << "\t0\n";
+		out << "L\t" << ev.seq << "\t0\t" << ev.seq << ": " << traceOpName(ev.op) << " (" << labels[ev.unit] << " " << ev.station << ")\n";
+		out << "S\t" << ev.seq << "\t0\tIs\n";
+		break;
+	    case (PE_READ):
+		out << "E\t" << ev.seq << "\t0\tIs\n";
+		out << "S\t" << ev.seq << "\t0\tRd\n";
+		break;
+	    case (PE_EXEC):
+		out << "E\t" << ev.seq << "\t0\tRd\n";
+		out << "S\t" << ev.seq << "\t0\tEx\n";
+		out << "L\t" << ev.seq << "\t1\t" << labels[ev.unit] << "Unit " << ev.fu + 1 << ", latency " << ev.arg << "\n";
+		break;
+	    case (PE_WB):
+		out << "E\t" << ev.seq << "\t0\tEx\n";
+		out << "S\t" << ev.seq << "\t0\tWb\n";
+		retiring.push_back(ev.seq);
+		flight.erase(ev.seq);
+		break;
+	    case (PE_STALL):
+		out << "L\t" << ev.seq << "\t1\tstalled " << ev.arg << " cycle(s) at " << ev.cycle << "\n";
+		break;
+	}
+    }
+
+    if (!retiring.empty()) {
+	out << "C\t1\n";
+	for (size_t i = 0; i < retiring.size(); ++i) {
+	    out << "R\t" << retiring[i] << "\t" << retired++ << "\t0\n";
+	}
+    }
+
+    return;
+}
+
+int main (int argc, char *argv[]) {
+
+    ifstream infile;			// Event trace
+    ofstream outfile;			// Converted trace
+    vector<string> labels;		// FU class labels
+    int konata = 0;			// Output format
+    int opt;				// Command line option
+
+    // Read options
+    while ((opt = getopt(argc, argv, "ck")) != -1) {
+	switch (opt) {
+	    case ('c'):
+		konata = 0;
+		break;
+	    case ('k'):
+		konata = 1;
+		break;
+	    default:
+		cout << "Invalid Usage...\n\t" << argv[0] << " [-c | -k] event_file output_file" << endl;
+		return -1;
+	}
+    }
+
+    if (argc - optind != 2) {
+	cout << "Invalid Usage...\n\t" << argv[0] << " [-c | -k] event_file output_file" << endl;
+	return -1;
+    }
+
+    infile.open(argv[optind], ios::binary);
+
+    if (!infile.is_open()) {
+	cout << "Event file not open...terminating" << endl;
+	return -1;
+    }
+
+    if (!readPipeHeader(infile, &labels)) {
+	cout << argv[optind] << " is not a pipeline event trace" << endl;
+	return -1;
+    }
+
+    outfile.open(argv[optind + 1]);
+
+    if (!outfile.is_open()) {
+	cout << "Output file not open...terminating" << endl;
+	return -1;
+    }
+
+    if (konata) {
+	writeKonata(infile, outfile, labels);
+    }
+    else {
+	writeChrome(infile, outfile, labels);
+    }
+
+    outfile.close();
+
+    return 0;
+}
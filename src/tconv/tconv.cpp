@@ -0,0 +1,80 @@
+// ////////////////////////////////////////////////////////
+// File: tconv.cpp
+// Description: Converts traces between the text, binary and
+//		packed formats read by tomsim
+// ////////////////////////////////////////////////////////
+
+#include "tracefile.h"
+
+using namespace std;
+
+int main (int argc, char *argv[]) {
+
+    TraceReader reader;			// Input trace
+    TraceWriter trace;			// Output trace
+    const TraceRecord * rec;		// Current instruction
+    int inFormat;			// Input TraceFormat
+    int outFormat;			// Output TraceFormat
+    int opt;				// Command line option
+
+    outFormat = -1;
+
+    // Read options
+    while ((opt = getopt(argc, argv, "btz")) != -1) {
+	switch (opt) {
+	    case ('b'):
+		outFormat = TRACE_BINARY;
+		break;
+	    case ('t'):
+		outFormat = TRACE_TEXT;
+		break;
+	    case ('z'):
+		outFormat = TRACE_PACKED;
+		break;
+	    default:
+		cout << "Invalid Usage...\n\t" << argv[0] << " [-b | -t | -z] input_trace output_trace" << endl;
+		return -1;
+	}
+    }
+
+    if (argc - optind != 2) {
+	cout << "Invalid Usage...\n\t" << argv[0] << " [-b | -t | -z] input_trace output_trace" << endl;
+	return -1;
+    }
+
+    inFormat = traceFileFormat(argv[optind]);
+
+    // Default to binary for text, text for the others
+    if (outFormat < 0) {
+	outFormat = (inFormat == TRACE_TEXT) ? TRACE_BINARY : TRACE_TEXT;
+    }
+
+    if (!openTraceReader(&reader, argv[optind])) {
+	cout << "Input Trace Not Valid...Terminating" << endl;
+	return -1;
+    }
+
+    if (!openTraceWriter(&trace, argv[optind + 1], outFormat)) {
+	cout << "Output Trace Not Open...Terminating" << endl;
+	closeTraceReader(&reader);
+	return -1;
+    }
+
+    while ((rec = readTrace(&reader)) != NULL) {
+	writeTrace(&trace, *rec);
+    }
+
+    if (reader.packed && reader.stream.damaged.load()) {
+	cout << "Input Trace damaged, converted up to the damaged block" << endl;
+    }
+    closeTraceReader(&reader);
+
+    if (!closeTraceWriter(&trace)) {
+	cout << "Error Writing Trace " << argv[optind + 1] << endl;
+	return -1;
+    }
+
+    cout << trace.count << " instructions written" << endl;
+
+    return 0;
+}
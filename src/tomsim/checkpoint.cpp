@@ -0,0 +1,592 @@
+// //////////////////////////////////////////////////////////////////
+// Filename: checkpoint.cpp
+// Description: Saves the complete state of a run between two cycles
+//		and restores it, so a run can stop and resume with
+//		identical results
+// //////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "tomsim.h"
+
+using namespace std;
+
+// Checkpoint identification
+#define CKPT_MAGIC "TOMC"
+#define CKPT_VERSION 9
+
+// Set by signal handlers, checked between cycles
+volatile sig_atomic_t checkpointSignal = CKPT_NONE;
+
+// /////////////////////////////////////////////////////////////////
+// Writing
+
+template <typename T>
+void putValue(ostream & out, const T & value) {
+    out.write((const char *) &value, sizeof(value));
+}
+
+template <typename T>
+void putVector(ostream & out, const vector<T> & values) {
+
+    uint64_t size = values.size();
+
+    putValue(out, size);
+    out.write((const char *) values.data(), size * sizeof(T));
+
+    return;
+}
+
+void putString(ostream & out, const string & value) {
+
+    uint32_t size = value.size();
+
+    putValue(out, size);
+    out.write(value.data(), size);
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Reading, failures leave the stream in a failed state
+
+template <typename T>
+void getValue(istream & in, T * value) {
+    in.read((char *) value, sizeof(*value));
+}
+
+// Bytes left in the file
+uint64_t bytesLeft(istream & in) {
+
+    streampos here = in.tellg();
+    uint64_t left;
+
+    in.seekg(0, ios::end);
+    left = (uint64_t) (in.tellg() - here);
+    in.seekg(here);
+
+    return left;
+}
+
+template <typename T>
+void getVector(istream & in, vector<T> * values) {
+
+    uint64_t size = 0;
+
+    getValue(in, &size);
+
+    // Sizes are checked against the configured layout by the caller,
+    // a damaged size must not allocate more than the file holds
+    if ((!in) || (size > bytesLeft(in) / sizeof(T))) {
+	in.setstate(ios::failbit);
+	return;
+    }
+
+    values -> resize(size);
+    in.read((char *) values -> data(), size * sizeof(T));
+
+    return;
+}
+
+void getString(istream & in, string * value) {
+
+    uint32_t size = 0;
+
+    getValue(in, &size);
+
+    if ((!in) || (size > 4096)) {
+	in.setstate(ios::failbit);
+	return;
+    }
+
+    value -> resize(size);
+    in.read(&((*value)[0]), size);
+
+    return;
+}
+
+// Every restored station vector holds one entry per station
+static int stationsSized(const StationTable & rs) {
+
+    size_t size = rs.size;
+
+    return (rs.busy.size() == size) && (rs.execycles.size() == size) && (rs.age.size() == size) && (rs.startexe.size() == size) &&
+	(rs.ready.size() == size) && (rs.funit.size() == size) && (rs.unit.size() == size) && (rs.op.size() == size) &&
+	(rs.seq.size() == size) && (rs.vj.size() == size) && (rs.vk.size() == size) && (rs.qj.size() == size) &&
+	(rs.qk.size() == size) && (rs.dest.size() == size) && (rs.busymask.size() == size / 64);
+}
+
+// A producer tag names a station of the table or no producer
+static int tagValid(const StationTable & rs, rstag tag) {
+    return (tag == TAG_READY) || (tag <= (rstag) rs.size);
+}
+
+// Operand tags may also carry a register file read
+static int operandValid(const StationTable & rs, rstag tag) {
+    return (tag & TAG_REGFILE) ? ((tag & ~TAG_REGFILE) < NUMREGS) : tagValid(rs, tag);
+}
+
+// A register number, or -1 for none
+static int regValid(int reg) {
+    return (reg >= -1) && (reg < NUMREGS);
+}
+
+// Sampling option as given on the command line
+static string sampleText(const SampleConfig & sample) {
+
+    if (sample.detail == 0) {
+	return "without -S";
+    }
+
+    return "with -S " + to_string(sample.detail) + "," + to_string(sample.period) + "," + to_string(sample.warmup);
+}
+
+// Position of the next instruction in the trace
+void traceWhere(Simulator * sim, uint64_t * record, int64_t * offset) {
+
+    *record = sim -> traceRead;
+    *offset = -1;
+
+    if ((sim -> reader != NULL) && (!sim -> reader -> binary) && (!sim -> reader -> packed) && (!sim -> traceDone)) {
+	*offset = sim -> reader -> text.tellg();
+    }
+
+    return;
+}
+
+// Continue reading the trace where the checkpoint left it
+int traceSeek(Simulator * sim, uint64_t record, int64_t offset) {
+
+    sim -> traceRead = record;
+
+    // Nothing more is read once the trace is done
+    if (sim -> traceDone) {
+	return 1;
+    }
+
+    // A program not yet running decodes up to the position
+    if (sim -> feed != NULL) {
+	TraceRecord rec;
+	for (uint64_t n = 0; n < record; ++n) {
+	    if (!decodeNext(&(sim -> feed -> prog), &rec)) {
+		return 0;
+	    }
+	}
+	sim -> traceRead = record;
+	return 1;
+    }
+
+    if (sim -> reader == NULL) {
+	if (record > sim -> numRecords) {
+	    return 0;
+	}
+	sim -> tracePos = record;
+	return 1;
+    }
+
+    if (sim -> reader -> binary || sim -> reader -> packed) {
+	return seekTrace(sim -> reader, record);
+    }
+
+    // Text written by a shared trace run has no offset, skip records
+    if (offset < 0) {
+	TraceRecord rec;
+	for (uint64_t n = 0; n < record; ++n) {
+	    if (!readTextRecord(sim -> reader -> text, &rec)) {
+		return 0;
+	    }
+	}
+    }
+    else {
+	sim -> reader -> text.clear();
+	sim -> reader -> text.seekg(offset);
+    }
+
+    return (bool) sim -> reader -> text;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Simulator between two cycles, checkpoint file name
+// Outputs: 1 if the checkpoint was written
+// Description: Written to a temporary file and renamed, so an old
+//		checkpoint survives a failure part way through
+// /////////////////////////////////////////////////////////////////
+int saveCheckpoint(Simulator * sim, const char * filename) {
+
+    StationTable & rs = sim -> rs;
+    string tmpname = string(filename) + ".tmp";
+    ofstream out;
+    uint32_t version = CKPT_VERSION;
+    uint32_t numClasses = sim -> fuclass.size();
+    uint64_t record;
+    int64_t offset;
+    vector<readyEntry> ready;
+    readyQueue queue;
+    size_t c;
+    int i;
+
+    out.open(tmpname.c_str(), ios::binary | ios::trunc);
+
+    if (!out.is_open()) {
+	return 0;
+    }
+
+    out.write(CKPT_MAGIC, 4);
+    putValue(out, version);
+
+    // Machine the state belongs to
+    putValue(out, numClasses);
+    for (c = 0; c < sim -> fuclass.size(); ++c) {
+	putString(out, sim -> fuclass[c].name);
+	putValue(out, sim -> fuclass[c].number);
+	putValue(out, sim -> fuclass[c].resnumber);
+	putValue(out, sim -> fuclass[c].latency);
+	putValue(out, sim -> fuclass[c].ii);
+	putValue(out, sim -> fuclass[c].busy);
+    }
+    putValue(out, sim -> opclass);
+    putValue(out, sim -> cdbWidth);
+
+    // Sampling periods the progress below belongs to
+    putValue(out, sim -> sample.detail);
+    putValue(out, sim -> sample.warmup);
+    putValue(out, sim -> sample.period);
+
+    // Statistics and control
+    putValue(out, sim -> numInst);
+    putValue(out, sim -> stalls);
+    putValue(out, sim -> regreads);
+    putValue(out, sim -> clockcycles);
+    putValue(out, sim -> keepIssue);
+    putValue(out, sim -> allowRO);
+    putValue(out, sim -> roSlot);
+    putValue(out, sim -> roStation);
+    putValue(out, sim -> busyStations);
+
+    // Registers, stations and units
+    putValue(out, sim -> renamereg);
+    putVector(out, rs.busy);
+    putVector(out, rs.execycles);
+    putVector(out, rs.age);
+    putVector(out, rs.startexe);
+    putVector(out, rs.ready);
+    putVector(out, rs.funit);
+    putVector(out, rs.op);
+    putVector(out, rs.seq);
+    putVector(out, rs.vj);
+    putVector(out, rs.vk);
+    putVector(out, rs.qj);
+    putVector(out, rs.qk);
+    putVector(out, rs.dest);
+    putVector(out, rs.busymask);
+    putVector(out, sim -> fus);
+
+    for (i = 0; i < rs.size; ++i) {
+	putVector(out, sim -> waitlist[i]);
+    }
+
+    // Ready queues in pop order
+    for (c = 0; c < sim -> readyq.size(); ++c) {
+	queue = sim -> readyq[c];
+	ready.clear();
+	while (!queue.empty()) {
+	    ready.push_back(queue.top());
+	    queue.pop();
+	}
+	putVector(out, ready);
+    }
+
+    // Instruction window and trace position
+    putValue(out, sim -> windowHead);
+    putValue(out, sim -> windowCount);
+    putValue(out, sim -> traceDone);
+    for (i = 0; i < INST_WINDOW; ++i) {
+	putValue(out, sim -> instWindow[i].seq);
+	putValue(out, sim -> instWindow[i].funit);
+	putValue(out, sim -> instWindow[i].opcode);
+	putValue(out, sim -> instWindow[i].dest);
+	putValue(out, sim -> instWindow[i].src[0]);
+	putValue(out, sim -> instWindow[i].src[1]);
+	putValue(out, sim -> instWindow[i].imm8);
+    }
+
+    traceWhere(sim, &record, &offset);
+    putValue(out, record);
+    putValue(out, offset);
+
+    // Cycle attribution
+    putVector(out, sim -> issueStalls);
+    putVector(out, sim -> operandWait);
+    putVector(out, sim -> unitWait);
+
+    // Common data bus
+    putValue(out, sim -> cdbWait);
+    putValue(out, sim -> cdbContention);
+    putVector(out, sim -> cdbHist);
+
+    // Sampling progress
+    putValue(out, sim -> samplePos);
+    putValue(out, sim -> sampleStart);
+    putValue(out, sim -> sampleStalls);
+    putValue(out, sim -> skipped);
+    putVector(out, sim -> cpiSamples);
+    putVector(out, sim -> spiSamples);
+
+    out.close();
+
+    if (out.fail()) {
+	remove(tmpname.c_str());
+	return 0;
+    }
+
+    return (rename(tmpname.c_str(), filename) == 0);
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Simulator configured with readConfig and a trace attached,
+//		checkpoint file name
+// Outputs: 1 if the state was restored
+// Description: The configuration must have the same classes, unit
+//		and station counts, instruction mapping, CDB width and
+//		sampling as the one that wrote the checkpoint. Latencies
+//		and initiation intervals may differ and apply to
+//		instructions that start after the restore.
+// /////////////////////////////////////////////////////////////////
+int loadCheckpoint(Simulator * sim, const char * filename) {
+
+    StationTable & rs = sim -> rs;
+    ifstream in;
+    char magic[4];
+    uint32_t version = 0;
+    uint32_t numClasses = 0;
+    int opclass[TRACE_NUM_OPS];
+    int cdbWidth = 0;
+    SampleConfig sample;
+    FUClass fc;
+    uint64_t record;
+    int64_t offset;
+    vector<readyEntry> ready;
+    vector<int> busy;
+    size_t units;
+    size_t c;
+    int i;
+
+    in.open(filename, ios::binary);
+
+    if (!in.is_open()) {
+	cout << "Checkpoint " << filename << " not open" << endl;
+	return 0;
+    }
+
+    in.read(magic, sizeof(magic));
+    getValue(in, &version);
+
+    if ((!in) || (memcmp(magic, CKPT_MAGIC, sizeof(magic)) != 0) || (version != CKPT_VERSION)) {
+	cout << filename << " is not a checkpoint" << endl;
+	return 0;
+    }
+
+    getValue(in, &numClasses);
+
+    if (!in) {
+	cout << "Checkpoint " << filename << " is damaged" << endl;
+	return 0;
+    }
+
+    if (numClasses != sim -> fuclass.size()) {
+	cout << "Checkpoint has " << numClasses << " FU classes, configuration has " << sim -> fuclass.size() << endl;
+	return 0;
+    }
+
+    for (c = 0; c < numClasses; ++c) {
+	getString(in, &fc.name);
+	getValue(in, &fc.number);
+	getValue(in, &fc.resnumber);
+	getValue(in, &fc.latency);
+	getValue(in, &fc.ii);
+	getValue(in, &fc.busy);
+	busy.push_back(fc.busy);
+
+	if (!in) {
+	    cout << "Checkpoint " << filename << " is damaged" << endl;
+	    return 0;
+	}
+
+	if ((fc.name != sim -> fuclass[c].name) || (fc.number != sim -> fuclass[c].number) || (fc.resnumber != sim -> fuclass[c].resnumber)) {
+	    cout << "Checkpoint class " << fc.name << " does not match the configuration" << endl;
+	    return 0;
+	}
+    }
+
+    getValue(in, &opclass);
+    getValue(in, &cdbWidth);
+    getValue(in, &(sample.detail));
+    getValue(in, &(sample.warmup));
+    getValue(in, &(sample.period));
+
+    if (!in) {
+	cout << "Checkpoint " << filename << " is damaged" << endl;
+	return 0;
+    }
+
+    if (memcmp(opclass, sim -> opclass, sizeof(opclass)) != 0) {
+	cout << "Checkpoint maps instructions to different classes than the configuration" << endl;
+	return 0;
+    }
+
+    if (cdbWidth != sim -> cdbWidth) {
+	cout << "Checkpoint has " << cdbWidth << " common data buses, configuration has " << sim -> cdbWidth << endl;
+	return 0;
+    }
+
+    // Samples of different periods do not make one estimate
+    if ((sample.detail != sim -> sample.detail) || (sample.warmup != sim -> sample.warmup) || (sample.period != sim -> sample.period)) {
+	cout << "Checkpoint was run " << sampleText(sample) << ", this run is " << sampleText(sim -> sample) << endl;
+	return 0;
+    }
+
+    // Same layout as the run that wrote the checkpoint
+    initStations(sim);
+    units = sim -> fus.size();
+
+    for (c = 0; c < numClasses; ++c) {
+	sim -> fuclass[c].busy = busy[c];
+    }
+
+    getValue(in, &(sim -> numInst));
+    getValue(in, &(sim -> stalls));
+    getValue(in, &(sim -> regreads));
+    getValue(in, &(sim -> clockcycles));
+    getValue(in, &(sim -> keepIssue));
+    getValue(in, &(sim -> allowRO));
+    getValue(in, &(sim -> roSlot));
+    getValue(in, &(sim -> roStation));
+    getValue(in, &(sim -> busyStations));
+
+    getValue(in, &(sim -> renamereg));
+    getVector(in, &rs.busy);
+    getVector(in, &rs.execycles);
+    getVector(in, &rs.age);
+    getVector(in, &rs.startexe);
+    getVector(in, &rs.ready);
+    getVector(in, &rs.funit);
+    getVector(in, &rs.op);
+    getVector(in, &rs.seq);
+    getVector(in, &rs.vj);
+    getVector(in, &rs.vk);
+    getVector(in, &rs.qj);
+    getVector(in, &rs.qk);
+    getVector(in, &rs.dest);
+    getVector(in, &rs.busymask);
+    getVector(in, &(sim -> fus));
+
+    if ((!in) || (!stationsSized(rs)) || (sim -> fus.size() != units)) {
+	cout << "Checkpoint " << filename << " is damaged" << endl;
+	return 0;
+    }
+
+    // Units, registers and producers of stations index the machine
+    for (i = 0; i < rs.size; ++i) {
+	if ((rs.funit[i] < 0) || (rs.funit[i] > sim -> fuclass[rs.unit[i]].number) || (rs.op[i] < 0) || (rs.op[i] >= TRACE_NUM_OPS) || (!regValid(rs.dest[i])) ||
+	    (!operandValid(rs, rs.vj[i])) || (!operandValid(rs, rs.vk[i])) || (!tagValid(rs, rs.qj[i])) || (!tagValid(rs, rs.qk[i]))) {
+	    in.setstate(ios::failbit);
+	}
+    }
+    for (i = 0; i < NUMREGS; ++i) {
+	if (!tagValid(rs, sim -> renamereg[i])) {
+	    in.setstate(ios::failbit);
+	}
+    }
+
+    // Waiting consumers and ready stations must be stations of the table
+    for (i = 0; i < rs.size; ++i) {
+	getVector(in, &(sim -> waitlist[i]));
+	for (size_t n = 0; n < sim -> waitlist[i].size(); ++n) {
+	    if ((sim -> waitlist[i][n].station < 0) || (sim -> waitlist[i][n].station >= rs.size)) {
+		in.setstate(ios::failbit);
+	    }
+	}
+    }
+
+    for (c = 0; c < numClasses; ++c) {
+	getVector(in, &ready);
+	for (size_t n = 0; n < ready.size(); ++n) {
+	    if ((ready[n].second < 0) || (ready[n].second >= rs.size) || (rs.unit[ready[n].second] != (int) c)) {
+		in.setstate(ios::failbit);
+		break;
+	    }
+	    sim -> readyq[c].push(ready[n]);
+	}
+    }
+
+    if (!in) {
+	cout << "Checkpoint " << filename << " is damaged" << endl;
+	return 0;
+    }
+
+    getValue(in, &(sim -> windowHead));
+    getValue(in, &(sim -> windowCount));
+    getValue(in, &(sim -> traceDone));
+    for (i = 0; i < INST_WINDOW; ++i) {
+	getValue(in, &(sim -> instWindow[i].seq));
+	getValue(in, &(sim -> instWindow[i].funit));
+	getValue(in, &(sim -> instWindow[i].opcode));
+	getValue(in, &(sim -> instWindow[i].dest));
+	getValue(in, &(sim -> instWindow[i].src[0]));
+	getValue(in, &(sim -> instWindow[i].src[1]));
+	getValue(in, &(sim -> instWindow[i].imm8));
+    }
+
+    getValue(in, &record);
+    getValue(in, &offset);
+
+    getVector(in, &(sim -> issueStalls));
+    getVector(in, &(sim -> operandWait));
+    getVector(in, &(sim -> unitWait));
+
+    getValue(in, &(sim -> cdbWait));
+    getValue(in, &(sim -> cdbContention));
+    getVector(in, &(sim -> cdbHist));
+
+    getValue(in, &(sim -> samplePos));
+    getValue(in, &(sim -> sampleStart));
+    getValue(in, &(sim -> sampleStalls));
+    getValue(in, &(sim -> skipped));
+    getVector(in, &(sim -> cpiSamples));
+    getVector(in, &(sim -> spiSamples));
+
+    if ((!in) || (sim -> issueStalls.size() != numClasses) || (sim -> operandWait.size() != numClasses) || (sim -> unitWait.size() != numClasses) ||
+	(sim -> cdbHist.empty()) || (sim -> roSlot < 0) || (sim -> roSlot >= INST_WINDOW) || (sim -> roStation < -1) || (sim -> roStation >= rs.size) ||
+	(sim -> windowHead < 0) || (sim -> windowHead >= INST_WINDOW) || (sim -> windowCount < 0) || (sim -> windowCount > INST_WINDOW) ||
+	(sim -> allowRO && (sim -> roStation < 0))) {
+	cout << "Checkpoint " << filename << " is damaged" << endl;
+	return 0;
+    }
+
+    // Instructions in the window name their class and registers
+    for (i = 0; i < sim -> windowCount; ++i) {
+	instNode & node = sim -> instWindow[(sim -> windowHead + i) % INST_WINDOW];
+	if ((node.funit >= numClasses) || (node.opcode >= TRACE_NUM_OPS) || (!regValid(node.dest)) || (!regValid(node.src[0])) || (!regValid(node.src[1]))) {
+	    in.setstate(ios::failbit);
+	}
+    }
+
+    if (!in) {
+	cout << "Checkpoint " << filename << " is damaged" << endl;
+	return 0;
+    }
+
+    if (!traceSeek(sim, record, offset)) {
+	cout << "Trace does not match checkpoint " << filename << endl;
+	return 0;
+    }
+
+    sim -> nextCheckpoint = sim -> clockcycles + sim -> checkpointInterval;
+
+    return 1;
+}
@@ -0,0 +1,90 @@
+// //////////////////////////////////////////////////////////////////
+// Filename: feed.cpp
+// Description: Runs the xsim decoder in a producer thread that feeds
+//		the simulator through a lock free ring, so a program
+//		is simulated without writing or reading a trace file
+// //////////////////////////////////////////////////////////////////
+
+#include "tomsim.h"
+
+#include <new>
+#include <stdlib.h>
+
+using namespace std;
+
+// Producer thread: decode until HALT or until the simulator stops
+void produceRecords(XFeed * feed) {
+
+    TraceRecord rec;
+
+    while (decodeNext(&(feed -> prog), &rec)) {
+	if (!ringPush(&(feed -> ring), rec)) {
+	    break;
+	}
+    }
+
+    ringFinish(&(feed -> ring));
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Outputs: Empty feed, NULL if out of memory
+// Description: The ring indices sit on their own cache lines, which
+//		plain new does not honor before C++17
+// /////////////////////////////////////////////////////////////////
+XFeed * newFeed() {
+
+    void * memory;
+
+    if (posix_memalign(&memory, alignof(XFeed), sizeof(XFeed)) != 0) {
+	return NULL;
+    }
+
+    return new (memory) XFeed;
+}
+
+// Release a feed from newFeed, its producer must be stopped
+void deleteFeed(XFeed * feed) {
+
+    feed -> ~XFeed();
+    free(feed);
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: xsim program file
+// Outputs: 1 if the program was loaded
+// Description: Records can be skipped with decodeNext until the
+//		producer is started
+// /////////////////////////////////////////////////////////////////
+int loadFeed(XFeed * feed, const char * filename) {
+
+    if (loadProgram(&(feed -> prog), filename) < 0) {
+	return 0;
+    }
+
+    initRing(&(feed -> ring), FEED_RING);
+
+    return 1;
+}
+
+// Start decoding on the producer thread
+void startFeed(XFeed * feed) {
+
+    feed -> producer = thread(produceRecords, feed);
+
+    return;
+}
+
+// Stop the producer, which may still be decoding, and wait for it
+void stopFeed(XFeed * feed) {
+
+    if (feed -> producer.joinable()) {
+	ringCancel(&(feed -> ring));
+	feed -> producer.join();
+    }
+
+    return;
+}
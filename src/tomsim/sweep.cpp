@@ -0,0 +1,252 @@
+// //////////////////////////////////////////////////////////////////
+// Filename: sweep.cpp
+// Description: Design space sweeps. One trace is loaded once and run
+//		against many configurations on a pool of threads.
+// //////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <jsoncpp/json/json.h>
+#include <jsoncpp/json/writer.h>
+
+#include "tomsim.h"
+
+using namespace std;
+
+// Work shared by the sweep threads
+struct SweepJob {
+    const TraceStore * trace;		// Shared read only trace
+    int eventDriven;			// Skip idle cycles
+    int phases;				// Profile pipeline phases
+    SampleConfig sample;		// Sampled simulation
+    const char * restore;		// Checkpoint every run starts from
+    vector<Json::Value> configs;	// Configuration of each run
+    vector<Json::Value> params;		// Grid point of each run
+    vector<Json::Value> results;	// Statistics of each run
+    atomic<size_t> next;		// Next run to start
+};
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Grid of "class.field" keys to value lists, base configuration
+// Description: Adds one configuration per point of the grid
+// /////////////////////////////////////////////////////////////////
+void expandGrid(SweepJob * job, const Json::Value & grid, const Json::Value & base) {
+
+    Json::Value::Members keys = grid.getMemberNames();
+    vector<Json::ArrayIndex> index(keys.size(), 0);
+    Json::Value config;
+    Json::Value point;
+    string cls, field;
+    size_t dot;
+    size_t k;
+
+    for (k = 0; k < keys.size(); ++k) {
+	if ((!grid[keys[k]].isArray()) || (grid[keys[k]].size() == 0)) {
+	    cout << "Grid entry " << keys[k] << " is not a list of values" << endl;
+	    return;
+	}
+    }
+
+    while (1) {
+	config = base;
+	point = Json::Value(Json::objectValue);
+
+	for (k = 0; k < keys.size(); ++k) {
+	    dot = keys[k].find('.');
+	    cls = keys[k].substr(0, dot);
+	    field = (dot == string::npos) ? "latency" : keys[k].substr(dot + 1);
+	    config[cls][field] = grid[keys[k]][index[k]];
+	    point[keys[k]] = grid[keys[k]][index[k]];
+	}
+
+	job -> configs.push_back(config);
+	job -> params.push_back(point);
+
+	// Advance the last key fastest
+	for (k = keys.size(); k > 0; --k) {
+	    if (++index[k - 1] < grid[keys[k - 1]].size()) {
+		break;
+	    }
+	    index[k - 1] = 0;
+	}
+	if (k == 0) {
+	    break;
+	}
+    }
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Sweep file name
+// Outputs: 1 if at least one configuration was read
+// Description: The sweep file is either a list of configurations, or
+//		a configuration with a "grid" of values to try, e.g.
+//		{"integer":{...}, "grid":{"divider.latency":[2,4,8]}}
+// /////////////////////////////////////////////////////////////////
+int readSweep(SweepJob * job, const char * filename) {
+
+    ifstream sweepfile;
+    Json::Value root;
+    Json::Value point;
+
+    sweepfile.open(filename);
+
+    if (!sweepfile.is_open()) {
+	cout << "Error Reading Sweep File ... Terminating" << endl;
+	return 0;
+    }
+
+    sweepfile >> root;
+
+    if (root.isArray()) {
+	for (Json::ArrayIndex i = 0; i < root.size(); ++i) {
+	    point = Json::Value(Json::objectValue);
+	    point["config"] = i;
+	    job -> configs.push_back(root[i]);
+	    job -> params.push_back(point);
+	}
+    }
+    else if (root.isMember("grid")) {
+	Json::Value grid = root["grid"];
+	root.removeMember("grid");
+	expandGrid(job, grid, root);
+    }
+    else {
+	job -> configs.push_back(root);
+	job -> params.push_back(Json::Value(Json::objectValue));
+    }
+
+    return (job -> configs.size() > 0);
+}
+
+// Run configurations until none are left
+void sweepWorker(SweepJob * job) {
+
+    Simulator * sim;
+    size_t n;
+    uint64_t start;
+
+    while ((n = (job -> next)++) < job -> configs.size()) {
+	sim = new Simulator;
+	sim -> log.level = LOG_ERROR;
+	sim -> eventDriven = job -> eventDriven;
+	sim -> profile.phases = job -> phases;
+	sim -> sample = job -> sample;
+	sim -> records = job -> trace -> records;
+	sim -> numRecords = job -> trace -> count;
+
+	start = profNow();
+	if (parseConfig(sim, job -> configs[n])) {
+	    sim -> profile.ns[PROF_CONFIG] = profNow() - start;
+	    if (job -> restore == NULL) {
+		initStations(sim);
+	    }
+	    else if (!loadCheckpoint(sim, job -> restore)) {
+		delete sim;
+		continue;
+	    }
+	    simulate(sim);
+	    job -> results[n] = makeResults(sim);
+	}
+
+	delete sim;
+    }
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Trace, sweep file, output file, number of threads
+// Outputs: Exit status
+// Description: Writes one table with a row per configuration
+// /////////////////////////////////////////////////////////////////
+int runSweep(const char * tracename, const char * sweepname, const char * outname, int threads, int eventDriven, int phases, const SampleConfig & sample, const char * restore) {
+
+    TraceStore trace;
+    SweepJob job;
+    vector<thread> pool;
+    ofstream outfile;
+    Json::Value table;
+    Json::Value row;
+    Json::StyledWriter styledWriter;
+    size_t n;
+    int t;
+    uint64_t start = profNow();
+    uint64_t load;
+
+    if (!loadTraceStore(&trace, tracename, threads)) {
+	cout << "Trace File not open...terminating" << endl;
+	return 0;
+    }
+    load = profNow() - start;
+
+    if (!readSweep(&job, sweepname)) {
+	freeTraceStore(&trace);
+	return 0;
+    }
+
+    job.trace = &trace;
+    job.eventDriven = eventDriven;
+    job.phases = phases;
+    job.sample = sample;
+    job.restore = restore;
+    job.results.assign(job.configs.size(), Json::Value(Json::nullValue));
+    job.next = 0;
+
+    if (threads > (int) job.configs.size()) {
+	threads = job.configs.size();
+    }
+    if (threads < 1) {
+	threads = 1;
+    }
+
+    cout << "Sweep: " << job.configs.size() << " configurations, " << trace.count << " instructions, " << threads << " threads" << endl;
+
+    for (t = 0; t < threads; ++t) {
+	pool.push_back(thread(sweepWorker, &job));
+    }
+    for (t = 0; t < threads; ++t) {
+	pool[t].join();
+    }
+
+    freeTraceStore(&trace);
+
+    // The trace is loaded once for every run
+    table["load"] = load / 1e9;
+    table["sweep seconds"] = (profNow() - start) / 1e9;
+
+    // Consolidated table, one row per configuration
+    table["trace"] = tracename;
+    table["runs"] = Json::Value(Json::arrayValue);
+
+    cout << "Run\tCycles\tStalls\tRegReads\tParameters" << endl;
+
+    for (n = 0; n < job.configs.size(); ++n) {
+	if (job.results[n].isNull()) {
+	    row = Json::Value(Json::objectValue);
+	    row["error"] = "invalid configuration";
+	}
+	else {
+	    row = job.results[n];
+	}
+	row["run"] = (Json::UInt) n;
+	row["params"] = job.params[n];
+	table["runs"].append(row);
+
+	cout << n << "\t" << row["cycles"].asUInt64() << "\t" << row["stalls"].asUInt64() << "\t" << row["reg reads"].asUInt64() << "\t\t" << Json::FastWriter().write(job.params[n]);
+    }
+
+    outfile.open(outname);
+
+    outfile << styledWriter.write(table);
+
+    outfile.close();
+
+    return 0;
+}
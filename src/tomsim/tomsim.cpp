@@ -1,899 +1,861 @@
 // //////////////////////////////////////////////////////////////////
 // Filename: tomsim.cpp
-// Description: This file implements a simulattion of Tomasulo's 
+// Description: This file implements a simulattion of Tomasulo's
 //		algorithm for dynamic instruction scheduling
 // Author: ZDHull
 // Date: 2016/12/19
 // //////////////////////////////////////////////////////////////////
 
 #include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
 #include <fstream>
 #include <iostream>
 #include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <math.h>
+#include <algorithm>
+#include <thread>
 #include <jsoncpp/json/json.h>
 #include <jsoncpp/json/writer.h>
 
-#define NUMREGS 8
-#define FILE_SIZE 300
-
-#define DEBUG
+#include "tomsim.h"
 
 using namespace std;
 
-// /////////////////////////////////////////////////////////////////////
-// Global Variables
-
-int numInst = 0;	// Number of instructions read from trace
-int stalls = 0;		// Number of pipeline stalls
-int regreads;		// Number of register reads
-int keepIssue;		// Flag for halt
-
-string renamereg [NUMREGS];	// Array of renamed registers
-
-// Enumerated FU's
-enum FUnits {IntUnit, DivUnit, MultUnit, LoadUnit, StoreUnit};
-
-// Variables Read from configuration file
-int numIntFU;
-int numLoadFU;
-int numMultFU;
-int numDivFU;
-int numStoreFU;
-int numIntRes;
-int numLoadRes;
-int numMultRes;
-int numDivRes;
-int numStoreRes;
-int intLatency;
-int loadLatency;
-int multLatency;
-int divLatency;
-int storeLatency;
-
-// Structure of Reservation Station Info
-struct idmstation {
-    bool busy = 0;		// Reservation station occupied
-    int execycles = 0;		// Number of execution cycles remaining
-    int age = 0;		// When instruction was issued
-    int startexe = 0;		// When instruction may begin execution
-    int funit = 0;		// Which function unit instruction has been assigned
-    int station = 0;		// Station ID
-    string op;			// Reservation Station Data
-    string vj;
-    string vk;
-    string qj;
-    string qk;
-} *intstation, *divstation, *multstation, *loadstation, *storestation, *currStation, *roStation, *exeStation, *wbStation;
-
-// Linked List node for instruction info
-struct instNode {	
-    string op;			// Operation Name
-    int funit;			// Which function type (Int, Mult, Div, Load, Store)
-    int finish = 0;		// Instruction finished
-    string arg1;		// RD
-    string arg2;		// RS
-    string arg3;		// RT
-    instNode * next = NULL;	// Next pointer
-};
-
-// Functional Unit Info
-struct FUInfo {
-    int inUse = 0;	// FU executing
-    int count = 0;	// Number of instruction executed
-} *fuptr, *FUIntData, *FUDivData, *FUMultData, *FULoadData, *FUStoreData;
-
-// Pointers to instruction linked list
-instNode * head = NULL;
-instNode * tail = NULL;
-
 // //////////////////////////////////////////////////////////////////////
 // Function Prototypes
 
-void printrename();
-int findrename(string regName);
-void printStations();
-void checkOperand(int clockcycles);
-void checkFU(int unit, int clockcycles);
-void availFU(int unit, idmstation * cStation, int clockcycles);
-void writebackCDB(idmstation * cStation, string resID);
-int checkFinish();
-void printFU();
-void readConfig(char * filename);
-void writeResults(char * filename, int clockcycles);
+string tagName(Simulator * sim, rstag tag);
+void printrename(Simulator * sim);
+int findrename(Simulator * sim, int reg);
+void readOperand(Simulator * sim, int reg, int station, int operand);
+void printStations(Simulator * sim);
+void markReady(Simulator * sim, int station);
+void checkFU(Simulator * sim, int unit);
+void writebackCDB(Simulator * sim, int station);
+int checkFinish(Simulator * sim);
+int skipIdle(Simulator * sim);
+void fastForward(Simulator * sim, uint64_t count);
+void countSample(Simulator * sim);
+int writebackLimited(Simulator * sim);
+int allocStation(Simulator * sim, int unit);
+void releaseStation(Simulator * sim, int station);
 
 // ///////////////////////////////////////////////////////////////////////
 // Local Functions
 
-// Print out the list of instructions for the program
-void printInst () {
-    instNode * current;
+inline rstag makeTag(int station) {
+    return (rstag) station + 1;
+}
+
+inline int tagStation(rstag tag) {
+    return (int) tag - 1;
+}
+
+// Fill a window slot for an instruction read from the trace. The
+// registers each instruction reads and writes are resolved here, once.
+void addRecord (Simulator * sim, instNode * node, const TraceRecord & rec) {
 
-    current = head;
+    node -> opcode = rec.op;
+    node -> funit = sim -> opclass[rec.op];
+    node -> imm8 = rec.imm8;
+    node -> dest = -1;
+    node -> src[0] = -1;
+    node -> src[1] = -1;
 
-    while (current != NULL) {
-	cout << current -> op << " " << current -> funit << " " << current -> arg1 << " " << current -> arg2 << " " << current -> arg3 << endl;
- 	current = current -> next;
+    switch (rec.op) {
+	case (N_HALT):
+	    break;
+	case (N_PUT):
+	    node -> src[0] = rec.rs;
+	    break;
+	case (N_LIZ):
+	case (N_LIS):
+	case (N_LUI):
+	    node -> dest = rec.rd;
+	    break;
+	case (N_LW):
+	    node -> src[0] = rec.rs;
+	    node -> dest = rec.rd;
+	    break;
+	case (N_SW):
+	    node -> src[0] = rec.rt;
+	    node -> src[1] = rec.rs;
+	    break;
+	default:
+	    node -> src[0] = rec.rs;
+	    node -> src[1] = rec.rt;
+	    node -> dest = rec.rd;
+	    break;
     }
 
-    cout << endl << endl;
+    (sim -> numInst)++;
+    node -> seq = sim -> numInst;
+
+    if (logOn(sim -> log, LOG_DEBUG, LOG_ISSUE)) {
+	cout << "Inst " << sim -> numInst << ": " << traceOpName(rec.op) << " " << node -> funit << " " << (int) node -> dest << " " << (int) node -> src[0] << " " << (int) node -> src[1] << endl;
+    }
 
     return;
 }
 
-// Add node to linked list for new instruction
-void addInst (string op, int unit, string ar1 = "", string ar2 = "", string ar3 = "") {
-   
-    // Create a node
-    instNode * newNode = new instNode;
+// Next record from the streamed or shared trace, NULL at the end
+const TraceRecord * nextRecord (Simulator * sim) {
 
-    // Copy the values to node
-    newNode -> op = op;
-    newNode -> funit = unit;
-    newNode -> arg1 = ar1;
-    newNode -> arg2 = ar2;
-    newNode -> arg3 = ar3;
+    if (sim -> feed != NULL) {
+	return ringPop(&(sim -> feed -> ring), &(sim -> feedRecord)) ? &(sim -> feedRecord) : NULL;
+    }
 
-    numInst++;
+    if (sim -> reader != NULL) {
+	return readTrace(sim -> reader);
+    }
 
-    // Empty List
-    if (head == NULL) {
-	head = newNode;
-	tail = newNode;
+    if (sim -> tracePos >= sim -> numRecords) {
+	return NULL;
     }
-    // Always add to end
-    else {
-	tail -> next = newNode;
-	tail = newNode;
+
+    return &(sim -> records[(sim -> tracePos)++]);
+}
+
+// Read instructions from the trace until the window is full
+void refillWindow (Simulator * sim) {
+
+    const TraceRecord * rec;
+    int slot;
+    uint64_t start = 0;
+
+    // Streamed parsing counts as trace load, not the phase that asked
+    if (sim -> profile.phases) {
+	start = profNow();
+    }
+
+    while ((!sim -> traceDone) && (sim -> windowCount < INST_WINDOW)) {
+	rec = nextRecord(sim);
+	if (rec == NULL) {
+	    sim -> traceDone = 1;
+	    break;
+	}
+
+	(sim -> traceRead)++;
+	slot = (sim -> windowHead + sim -> windowCount) % INST_WINDOW;
+	addRecord(sim, &(sim -> instWindow[slot]), *rec);
+	(sim -> windowCount)++;
+
+	// Nothing after HALT is simulated
+	if (rec -> op == N_HALT) {
+	    sim -> traceDone = 1;
+	}
+    }
+
+    if (sim -> profile.phases) {
+	start = profNow() - start;
+	sim -> profile.ns[PROF_LOAD] += start;
+	sim -> profile.nested += start;
     }
 
     return;
 }
 
-// Delete the nodes in a linked list
-void clearInst () {
-
-    instNode * current;
+// Next instruction to issue, NULL when the trace is finished
+instNode * nextInst (Simulator * sim) {
 
-    // Until list is empty
-    while (head != NULL) {
-	// Done?
-	if (tail == head) {
-	    tail = NULL;
+    if (sim -> windowCount == 0) {
+	refillWindow(sim);
+	if (sim -> windowCount == 0) {
+	    return NULL;
 	}
-	// Adjust pointers and delete
-	current = head;
-	head = current -> next;
-	current -> next = NULL;
- 	delete current;
     }
 
+    return &(sim -> instWindow[sim -> windowHead]);
+}
+
+// Remove the issued instruction from the window. The slot is not
+// reused until the window is refilled, after read operand.
+void popInst (Simulator * sim) {
+
+    sim -> windowHead = (sim -> windowHead + 1) % INST_WINDOW;
+    (sim -> windowCount)--;
+
+    return;
+}
+
+// Ask for a checkpoint at the end of the current cycle
+void requestCheckpoint (int signum) {
+
+    checkpointSignal = (signum == SIGUSR1) ? CKPT_SAVE : CKPT_STOP;
+
     return;
 }
 
 int main (int argc, char *argv[]) {
 
-    ifstream tracefile;			// Input Trace
-    string line;			// Line
-    string op;				// Instruction
-    string instargs[3];			
-    string rd, rs, rt, imm8;		// Register numbers and immediate
-    instNode * currentInst = NULL;	// Pointers to instructions
-    instNode * roInst = NULL;
+    Simulator * sim;			// Single run
+    TraceReader tracefile;		// Input Trace
+    XFeed * feed = NULL;		// Program decoded in process
+    int program = 0;			// Trace argument is an xsim program
     char inputfile[FILE_SIZE];		// Input trace name
-    int clockcycles;			// Number of clock cycles
+    int eventDriven = 0;		// Skip idle cycles
+    int sweep = 0;			// Configuration is a sweep file
+    int threads = 0;			// Sweep worker threads
+    LogConfig log;			// Console output
+    PipeRecorder recorder;		// Pipeline events
+    char * eventfile = NULL;		// Pipeline event file name
+    TimelineWriter timeline;		// Instruction timelines
+    char * timelinefile = NULL;		// Timeline file name
+    int phases = 0;			// Profile pipeline phases
+    char * checkpoint = NULL;		// Checkpoint file name
+    uint64_t interval = 0;		// Cycles between checkpoints
+    char * restore = NULL;		// Checkpoint to resume from
+    SampleConfig sample;		// Sampled simulation
+    uint64_t start;			// Host time
+
+    int opt;				// Command line option
+
+    // Read options
+    while ((opt = getopt(argc, argv, "esxj:v:l:r:t:pc:n:R:S:")) != -1) {
+	switch (opt) {
+	    case ('e'):
+		eventDriven = 1;
+		break;
+	    case ('s'):
+		sweep = 1;
+		break;
+	    case ('x'):
+		program = 1;
+		break;
+	    case ('j'):
+		threads = atoi(optarg);
+		break;
+	    case ('v'):
+		log.level = parseLogLevel(optarg);
+		if (log.level < 0) {
+		    cout << "Unknown log level " << optarg << " (error, info, debug, trace)" << endl;
+		    return 0;
+		}
+		break;
+	    case ('p'):
+		phases = 1;
+		break;
+	    case ('c'):
+		checkpoint = optarg;
+		break;
+	    case ('n'):
+		interval = strtoull(optarg, NULL, 10);
+		break;
+	    case ('R'):
+		restore = optarg;
+		break;
+	    case ('t'):
+		timelinefile = optarg;
+		break;
+	    case ('S'):
+		if ((sscanf(optarg, "%d,%" SCNu64 ",%d", &sample.detail, &sample.period, &sample.warmup) < 2) || (sample.detail < 1) ||
+		    (sample.warmup < 0) || (sample.period < (uint64_t) (sample.detail + sample.warmup))) {
+		    cout << "Sampling is -S detail,period[,warmup] with detail + warmup at most period" << endl;
+		    return 0;
+		}
+		break;
+	    case ('r'):
+		eventfile = optarg;
+		break;
+	    case ('l'):
+		if (!parseLogMask(optarg, &log.mask)) {
+		    cout << "Unknown log category in " << optarg << " (issue, ro, exec, wb, rename, config, all)" << endl;
+		    return 0;
+		}
+		break;
+	    default:
+		cout << "Usage Error: " << argv[0] << " [-e] [-p] [-s] [-x] [-j threads] [-v level] [-l categories] [-r event_file] [-t timeline_file] [-c checkpoint [-n cycles]] [-R checkpoint] [-S detail,period[,warmup]] trace_file configuration output_file" << endl;
+		return 0;
+	}
+    }
 
-    if (argc != 4) {
-	cout << "Usage Error: " << argv[0] << " trace_file configuration output_file" << endl;
+    if (argc - optind != 3) {
+	cout << "Usage Error: " << argv[0] << " [-e] [-p] [-s] [-x] [-j threads] [-v level] [-l categories] [-r event_file] [-t timeline_file] [-c checkpoint [-n cycles]] [-R checkpoint] [-S detail,period[,warmup]] trace_file configuration output_file" << endl;
 	return 0;
     }
 
     // Copy trace file name
-    strcpy(inputfile, argv[1]);
+    strcpy(inputfile, argv[optind]);
+
+    // Every configuration in the sweep file against one trace
+    if (sweep && program) {
+	cout << "A sweep needs a trace file, not a program" << endl;
+	return 0;
+    }
 
-    // Open file
-    tracefile.open(inputfile);
+    // Recordings start with an empty machine, a resumed run has
+    // instructions in flight that were issued before the checkpoint
+    if ((restore != NULL) && ((eventfile != NULL) || (timelinefile != NULL))) {
+	cout << "-r and -t record from the first cycle and cannot be combined with -R" << endl;
+	return 0;
+    }
+
+    if (sweep) {
+	if (threads <= 0) {
+	    threads = thread::hardware_concurrency();
+	}
+	return runSweep(inputfile, argv[optind + 1], argv[optind + 2], threads, eventDriven, phases, sample, restore);
+    }
 
-    // Check if file is open
-    if (!tracefile.is_open()) {
+    sim = new Simulator;
+    sim -> eventDriven = eventDriven;
+    sim -> log = log;
+    sim -> reader = &tracefile;
+    sim -> profile.phases = phases;
+    sim -> checkpointFile = checkpoint;
+    sim -> checkpointInterval = interval;
+    sim -> sample = sample;
+
+    // SIGUSR1 saves a checkpoint, SIGTERM and SIGINT save one and stop
+    if (checkpoint != NULL) {
+	signal(SIGUSR1, requestCheckpoint);
+	signal(SIGTERM, requestCheckpoint);
+	signal(SIGINT, requestCheckpoint);
+    }
+
+    // Open file, or decode the program alongside the simulation
+    start = profNow();
+    if (program) {
+	feed = newFeed();
+	if ((feed == NULL) || (!loadFeed(feed, inputfile))) {
+	    cout << "Program File not open...terminating" << endl;
+	    if (feed != NULL) {
+		deleteFeed(feed);
+	    }
+	    delete sim;
+	    return 0;
+	}
+	sim -> reader = NULL;
+	sim -> feed = feed;
+    }
+    else if (!openTraceReader(&tracefile, inputfile)) {
 	cout << "Trace File not open...terminating" << endl;
+	delete sim;
 	return 0;
     }
+    sim -> profile.ns[PROF_LOAD] = profNow() - start;
 
     // Read the configuration file
-    readConfig(argv[2]);
-
-    // Initialize dynamic variables based on config file
-    intstation = new idmstation [numIntRes];
-    divstation = new idmstation [numDivRes];
-    multstation = new idmstation [numMultRes];
-    loadstation = new idmstation [numLoadRes];
-    storestation = new idmstation [numStoreRes];
-    FUIntData = new FUInfo [numIntFU];
-    FUDivData = new FUInfo [numDivFU];
-    FUMultData = new FUInfo [numMultFU];
-    FULoadData = new FUInfo [numLoadFU];
-    FUStoreData = new FUInfo [numStoreFU];
-
-    op[0] = '\0';
-
-    // Start reading the tracefile
-    while (op != "HALT") {
-	// Read operation from line and add new linked list node according to type
-	tracefile >> op;
-	if ((op == "ADD") || (op == "SUB") || (op == "NOR") || (op == "AND")) {
-	    tracefile >> rd;
-	    tracefile >> rs;
-	    tracefile >> rt;
-	    addInst(op, IntUnit, rd, rs, rt);
-	}
-	else if ((op == "DIV") || (op == "EXP") || (op == "MOD")) {
-	    tracefile >> rd;
-	    tracefile >> rs;
-	    tracefile >> rt;
-	    addInst(op, DivUnit, rd, rs, rt);
-	}
-	else if (op == "MUL") {
-	    tracefile >> rd;
-	    tracefile >> rs;
-	    tracefile >> rt;
-	    addInst(op, MultUnit, rd, rs, rt);
-	}
-	else if (op == "PUT") {
-	    tracefile >> rs;
-	    addInst(op, IntUnit, rs);
-	}
-	else if (op == "HALT") {
-	    addInst(op, IntUnit);
-	    break;
+    start = profNow();
+    if (!readConfig(sim, argv[optind + 1])) {
+	delete sim;
+	return 0;
+    }
+    sim -> profile.ns[PROF_CONFIG] = profNow() - start;
+
+    // Initialize dynamic variables based on config file, or resume
+    if (restore != NULL) {
+	if (!loadCheckpoint(sim, restore)) {
+	    delete sim;
+	    return 0;
 	}
-	else if (op == "SW") {
-	    tracefile >> rt;
-	    tracefile >> rs;
-	    addInst(op, StoreUnit, rt, rs);
+	if (logOn(sim -> log, LOG_INFO, LOG_ALL)) {
+	    cout << "Resuming at cycle " << sim -> clockcycles << endl;
 	}
-	else if (op == "LW") {
-	    tracefile >> rd;
-	    tracefile >> rs;
-	    addInst(op, LoadUnit, rd, rs);
+    }
+    else {
+	initStations(sim);
+    }
+
+    // Record pipeline events
+    if (eventfile != NULL) {
+	vector<string> labels;
+	for (size_t c = 0; c < sim -> fuclass.size(); ++c) {
+	    labels.push_back(sim -> fuclass[c].label);
 	}
-	else if ((op == "LIZ") || (op == "LIS") || (op == "LUI")) {
-	    tracefile >> rd;
-	    tracefile >> imm8;
-	    addInst(op, IntUnit, rd, imm8);
+	if (!openPipeRecorder(&recorder, eventfile, labels)) {
+	    cout << "Event File not open...terminating" << endl;
+	    delete sim;
+	    return 0;
 	}
+	sim -> recorder = &recorder;
     }
 
-#ifdef DEBUG
-    printInst();
-    cout << "Inst: " << numInst << endl << endl;
-#endif
+    // Record instruction timelines
+    if (timelinefile != NULL) {
+	vector<string> labels;
+	for (size_t c = 0; c < sim -> fuclass.size(); ++c) {
+	    labels.push_back(sim -> fuclass[c].label);
+	}
+	if (!openTimeline(&timeline, timelinefile, labels, sim -> rs.size)) {
+	    cout << "Timeline File not open...terminating" << endl;
+	    delete sim;
+	    return 0;
+	}
+	sim -> timeline = &timeline;
+    }
 
-    tracefile.close();
+    // The decoder runs on its own core while the simulation runs
+    if (feed != NULL) {
+	startFeed(feed);
+    }
 
-    currentInst = head;
+    simulate(sim);
 
-    int i;		// Counting Variable
-    int newIssue = 0;	// Flags
-    int allowRO = 0;
-    clockcycles = 0;	// Set clock cycles
-    regreads = 0;	// Set register reads
-    keepIssue = 1;	// Flag
+    if (feed != NULL) {
+	stopFeed(feed);
+	deleteFeed(feed);
+    }
 
-    printStations();
+    if (sim -> recorder != NULL) {
+	closePipeRecorder(&recorder);
+	if (logOn(sim -> log, LOG_INFO, LOG_ALL)) {
+	    cout << "Pipeline Events: " << recorder.total << endl;
+	}
+    }
 
-    // Start Scheduling
-    while (1) {
-	// Read Operand
-	if (allowRO) {
-	    switch (roInst -> funit) {
-		case (IntUnit):
-		    if (roInst -> op == "HALT") {
-			roStation -> op = "HALT";
-			roStation -> age = clockcycles;
-			checkFU(IntUnit, clockcycles);
-			break;
-		    }
-		    else if (roInst -> op == "PUT") {
-			roStation -> op = "PUT";
-			roStation -> age = clockcycles;
-			if (findrename(roInst -> arg1)) {
-			    roStation -> qj = renamereg[(roInst -> arg1[1])-'0'];
-			}
-			else {
-			    roStation -> vj = roInst -> arg1;
-			    regreads++;
-			}
-			if ((roStation -> qj).empty()) {
-			    checkFU(IntUnit, clockcycles);
-			}
-			else {
-			    roStation -> execycles = -1;
-			    roStation -> startexe = -1;
-			}
-			break;
-		    }
-		    else if ((roInst -> op == "LIS") || (roInst -> op == "LUI") || (roInst -> op == "LIZ")) {
-			roStation -> op = roInst -> op;
-			roStation -> age = clockcycles;
-			if ((roStation -> qj).empty()) {
-			    checkFU(IntUnit, clockcycles);
-			}
-			else {
-			    roStation -> execycles = -1;
-			    roStation -> startexe = -1;
-			}
-			renamereg[(roInst -> arg1[1]) - '0'] = "INT" + to_string(roStation -> station);
-			break;
-		    }
-		    roStation -> op = roInst -> op;
-		    roStation -> age = clockcycles;
-		    if (findrename(roInst -> arg2)) {
-			roStation -> qj = renamereg[(roInst -> arg2[1])-'0'];
-		    }
-		    else {
-			roStation -> vj = roInst -> arg2;
-			regreads++;
-		    }
-			
-		    if (findrename(roInst -> arg3)) {	
-			roStation -> qk = renamereg[(roInst -> arg3[1])-'0'];
-		    }
-		    else {
-			roStation -> vk = roInst -> arg3;
-			regreads++;
-		    }
-	
-		    if ((!(roStation -> vj).empty()) && (!(roStation -> vj).empty())) {
-			checkFU(IntUnit, clockcycles);
-		    }
-		    else {
-			roStation -> execycles = -1;
-		        roStation -> startexe = -1;
-		    }
-		    renamereg[(roInst -> arg1[1]) - '0'] = "INT" + to_string(roStation -> station);
-	
-		    break;
-		case (DivUnit):
-		    roStation -> op = roInst -> op;
-		    roStation -> age = clockcycles;
-		    if (findrename(roInst -> arg2)) {
-			roStation -> qj = renamereg[(roInst -> arg2[1])-'0'];
-		    }
-		    else {
-			roStation -> vj = roInst -> arg2;
-			regreads++;
-		    }
-			
-		    if (findrename(roInst -> arg3)) {	
-			roStation -> qk = renamereg[(roInst -> arg3[1])-'0'];
-		    }
-		    else {
-			roStation -> vk = roInst -> arg3;
-			regreads++;
-		    }
-	
-		    if ((!(roStation -> vj).empty()) && (!(roStation -> vj).empty())) {
-			checkFU(DivUnit, clockcycles);
-		    }
-		    else {
-			roStation -> execycles = -1;
-		        roStation -> startexe = -1;
-		    }
-		    renamereg[(roInst -> arg1[1]) - '0'] = "DIV" + to_string(roStation - &divstation[0]);
-	
-		    break;
-		case (MultUnit):
-		    roStation -> op = roInst -> op;
-		    roStation -> age = clockcycles;
-		    if (findrename(roInst -> arg2)) {
-			roStation -> qj = renamereg[(roInst -> arg2[1])-'0'];
-		    }
-		    else {
-			roStation -> vj = roInst -> arg2;
-			regreads++;
-		    }
-			
-		    if (findrename(roInst -> arg3)) {	
-			roStation -> qk = renamereg[(roInst -> arg3[1])-'0'];
-		    }
-		    else {
-			roStation -> vk = roInst -> arg3;
-			regreads++;
-		    }
-	
-		    if ((!(roStation -> vj).empty()) && (!(roStation -> vj).empty())) {
-			checkFU(MultUnit, clockcycles);
-		    }
-		    else {
-			roStation -> execycles = -1;
-		        roStation -> startexe = -1;
-		    }
-		    renamereg[(roInst -> arg1[1]) - '0'] = "MULT" + to_string(roStation - &multstation[0]);
-	
-		    break;
-		case (LoadUnit):
-		    roStation -> op = roInst -> op;
-		    roStation -> age = clockcycles;
-		    if (findrename(roInst -> arg2)) {
-			roStation -> qj = renamereg[(roInst -> arg2[1])-'0'];
-		    }
-		    else {
-			roStation -> vj = roInst -> arg2;
-			regreads++;
-		    }
+    if (sim -> timeline != NULL) {
+	closeTimeline(&timeline);
+	if (logOn(sim -> log, LOG_INFO, LOG_ALL)) {
+	    cout << "Timeline Rows: " << timeline.total << endl;
+	}
+    }
 
-		    if ((roStation -> qj).empty()) {
-			checkFU(LoadUnit, clockcycles);
-		    }
-		    else {
-			roStation -> execycles = -1;
-			roStation -> startexe = -1;
-		    }
-		    renamereg[(roInst -> arg1[1]) - '0'] = "LD" + to_string(roStation - & loadstation[0]);
+    if (!program) {
+	if (tracefile.packed && tracefile.stream.damaged.load()) {
+	    cout << "Trace File damaged, simulated up to the damaged block" << endl;
+	}
+	closeTraceReader(&tracefile);
+    }
 
-		    break;
-		case (StoreUnit):
-		    roStation -> op = roInst -> op;
-		    roStation -> age = clockcycles;
-		    if (findrename(roInst -> arg1)) {
-			roStation -> qj = renamereg[(roInst -> arg1[1])-'0'];
-		    }
-		    else {
-			roStation -> vj = roInst -> arg1;
-			regreads++;
-		    }
-		    if (findrename(roInst -> arg2)) {
-			roStation -> qk = renamereg[(roInst -> arg2[1])-'0'];
-		    }
-		    else {
-			roStation -> vk = roInst -> arg2;
-			regreads++;
-		    }
+    // Stopped by a signal, resume later from the checkpoint
+    if (sim -> stopped) {
+	cout << "Stopped at cycle " << sim -> clockcycles << ", resume with -R " << checkpoint << endl;
+	delete sim;
+	return 0;
+    }
 
-		    if (((roStation -> qj).empty()) && ((roStation -> qk).empty())) {
-			checkFU(StoreUnit, clockcycles);
-		    }
-		    else {
-			roStation -> execycles = -1;
-			roStation -> startexe = -1;
-		    }
+    // Print some stuff
+    if (logOn(sim -> log, LOG_DEBUG, LOG_ISSUE)) {
+	cout << "Inst: " << sim -> numInst << endl;
+    }
 
-		    break;
-		default:
-		    break;	
-	    }
-	    allowRO = 0; 	
+    // Final statistics, any category shows them
+    if (logOn(sim -> log, LOG_INFO, LOG_ALL)) {
+	cout << endl << "Num Clock Cycles: " << sim -> clockcycles << endl;
+	printFU(sim);
+	cout << "Register Reads: " << sim -> regreads << endl;
+	cout << "Pipeline Stall: " << sim -> stalls << endl;
+	if (sim -> skipped > 0) {
+	    Json::Value estimate = makeResults(sim);
+	    cout << "Estimated Cycles: " << estimate["cycles"].asUInt64() << " +- " << estimate["cycles ci95"].asDouble() << " (" << sim -> cpiSamples.size() << " samples, " << sim -> skipped << " instructions fast forwarded)" << endl;
 	}
+	cout << "Host Time: " << sim -> profile.simulate / 1e9 << " s, " << (uint64_t) (sim -> clockcycles / (sim -> profile.simulate / 1e9)) << " cycles/s" << endl;
+    }
 
-	// WRITE BACK
-	for (i = 0; i < numIntRes; ++i) {
-	    wbStation = &intstation[i];
-	    if (wbStation -> busy) {
-		if ((wbStation -> execycles == 0) && (wbStation -> startexe > 0)) {
-		    writebackCDB(wbStation, "INT" + to_string(i));
-		}
-	    }
-	}	
+    // Write the output
+    writeResults(sim, argv[optind + 2]);
 
-	for (i = 0; i < numDivRes; ++i) {
-	    wbStation = &divstation[i];
-	    if (wbStation -> busy) {
-		if ((wbStation -> execycles == 0) && (wbStation -> startexe > 0)) {
-		    writebackCDB(wbStation, "DIV" + to_string(i));
-		}
+    delete sim;
+
+    return 0;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Configured simulator with a trace attached
+// Outputs: Number of clock cycles
+// Description: Runs the trace to completion
+// /////////////////////////////////////////////////////////////////
+uint64_t simulate (Simulator * sim) {
+
+    StationTable & rs = sim -> rs;
+    instNode * currentInst = NULL;	// Pointers to instructions
+    instNode * roInst = NULL;
+    int dest;				// Renamed destination register
+    int i;				// Counting Variable
+    int unit;				// FU class
+    int broadcasts;			// Writebacks this cycle
+    int currStation = -1;		// Station allocated at issue
+    int newIssue = 0;			// Flags
+
+    // Read operand state carries over between cycles and is checkpointed
+    int & allowRO = sim -> allowRO;
+    int & roStation = sim -> roStation;
+    size_t w;				// Bitmask word
+    uint64_t bits;			// Occupied stations in word
+    Profile * prof = &(sim -> profile);	// Host time
+    int phases = prof -> phases;	// Time each phase
+    uint64_t start = profNow();		// Start of the run
+
+    prof -> mark = start;
+    prof -> nested = 0;
+
+    // Instructions are read from the trace as they are issued
+    currentInst = nextInst(sim);
+
+    if (logOn(sim -> log, LOG_TRACE, LOG_EXEC)) {
+	printStations(sim);
+    }
+
+    // Start Scheduling
+    while (1) {
+	// Jump ahead to the next writeback when no stage can make progress
+	if (sim -> eventDriven && !allowRO) {
+	    i = skipIdle(sim);
+	    sim -> clockcycles += i;
+	    sim -> cdbHist[0] += i;
+	}
+	if (phases) {
+	    profCharge(prof, PROF_SKIP);
+	}
+
+	// Read Operand
+	if (allowRO) {
+	    roInst = &(sim -> instWindow[sim -> roSlot]);
+	    rs.op[roStation] = roInst -> opcode;
+	    rs.age[roStation] = sim -> clockcycles;
+	    rs.seq[roStation] = roInst -> seq;
+	    dest = roInst -> dest;
+	    if (sim -> recorder != NULL) {
+		recordEvent(sim -> recorder, PE_READ, sim -> clockcycles, roInst -> seq, roInst -> funit, roStation - sim -> fuclass[roInst -> funit].base, roInst -> opcode, 0, 0);
+	    }
+	    if (sim -> timeline != NULL) {
+		timelineRead(sim -> timeline, roStation, sim -> clockcycles);
+	    }
+	    if (roInst -> src[0] >= 0) {
+		readOperand(sim, roInst -> src[0], roStation, 0);
+	    }
+	    if (roInst -> src[1] >= 0) {
+		readOperand(sim, roInst -> src[1], roStation, 1);
 	    }
-	}	
 
-	for (i = 0; i < numMultRes; ++i) {
-	    wbStation = &multstation[i];
-	    if (wbStation -> busy) {
-		if ((wbStation -> execycles == 0) && (wbStation -> startexe > 0)) {
-		    writebackCDB(wbStation, "MULT" + to_string(i));
-		}
+	    if ((rs.qj[roStation] == TAG_READY) && (rs.qk[roStation] == TAG_READY)) {
+		markReady(sim, roStation);
+		checkFU(sim, roInst -> funit);
+	    }
+	    else {
+		rs.execycles[roStation] = -1;
+		rs.startexe[roStation] = 0;
 	    }
-	}	
 
-	for (i = 0; i < numLoadRes; ++i) {
-	    wbStation = &loadstation[i];
-	    if (wbStation -> busy) {
-		if ((wbStation -> execycles == 0) && (wbStation -> startexe > 0)) {
-		    writebackCDB(wbStation, "LD" + to_string(i));
-		}
+	    // Rename the destination after the sources are read
+	    if (dest >= 0) {
+		sim -> renamereg[dest] = makeTag(roStation);
+		rs.dest[roStation] = dest;
 	    }
+	    allowRO = 0;
+	}
+	if (phases) {
+	    profCharge(prof, PROF_READ);
+	}
+
+	// WRITE BACK
+	if (sim -> cdbWidth > 0) {
+	    broadcasts = writebackLimited(sim);
 	}
-	
-	for (i = 0; i < numStoreRes; ++i) {
-	    wbStation = &storestation[i];
-	    if (wbStation -> busy) {
-		if ((wbStation -> execycles == 0) && (wbStation -> startexe > 0)) {
-		    writebackCDB(wbStation, "STORE" + to_string(i));
+	else {
+	    broadcasts = 0;
+	    for (w = 0; w < rs.busymask.size(); ++w) {
+		bits = rs.busymask[w];
+		while (bits) {
+		    i = (w * 64) + __builtin_ctzll(bits);
+		    bits &= bits - 1;
+		    if ((rs.execycles[i] == 0) && (rs.startexe[i] > 0)) {
+			writebackCDB(sim, i);
+			broadcasts++;
+		    }
 		}
 	    }
-	}	
+	}
+	if (broadcasts >= (int) sim -> cdbHist.size()) {
+	    sim -> cdbHist.resize(broadcasts + 1, 0);
+	}
+	(sim -> cdbHist[broadcasts])++;
+	if (phases) {
+	    profCharge(prof, PROF_WB);
+	}
+
+	for (unit = 0; unit < (int) sim -> fuclass.size(); ++unit) {
+	    checkFU(sim, unit);
+	}
+	if (phases) {
+	    profCharge(prof, PROF_CHECKFU);
+	}
 
-	checkFU(IntUnit, clockcycles);
-	checkFU(DivUnit, clockcycles);
-	checkFU(MultUnit, clockcycles);
-	checkFU(LoadUnit, clockcycles);
-	checkFU(StoreUnit, clockcycles);
+	if (logOn(sim -> log, LOG_TRACE, LOG_RENAME)) {
+	    printrename(sim);
+	}
 
-	printrename();
+	// Skip ahead once the detailed part of a sampling period is done
+	if ((sim -> sample.detail > 0) && (sim -> samplePos >= (uint64_t) (sim -> sample.warmup + sim -> sample.detail))) {
+	    fastForward(sim, sim -> sample.period - sim -> sample.warmup - sim -> sample.detail);
+	    sim -> samplePos = 0;
+	}
 
 	// ISSUE
-	if (keepIssue && (currentInst != NULL)) {
-	    switch (currentInst -> funit) {
-		case (IntUnit):
-		    for (i = 0; i < numIntRes; ++i) {
-			if (!intstation[i].busy) {
-			    cout << "Have Int " << i << endl;
-			    intstation[i].busy = true;
-			    intstation[i].station = i;
-			    currStation = &intstation[i];
-			    newIssue = 1;
-			    break;
-		        }
-		    }
-		    break;
-		case (DivUnit):
-		    for (i = 0; i < numDivRes; ++i) {
-			if (!divstation[i].busy) {
-			    cout << "Have Div " << i <<endl;
-			    divstation[i].busy = true;
-			    divstation[i].station = i;
-			    currStation = &divstation[i];
-			    newIssue = 1;
-			    break;
-			}
-		    }
-		    break;
-		case (MultUnit):
-		    for (i = 0; i < numMultRes; ++i) {
-			if (!multstation[i].busy) {
-			    cout << "Have Mult " << i <<endl;
-			    multstation[i].busy = true;
-			    multstation[i].station = i;
-			    currStation = &multstation[i];
-			    newIssue = 1;
-			    break;
-			}
-		    }
-		    break;
-		case (LoadUnit):
-		    for (i = 0; i < numLoadRes; ++i) {
-			if (!loadstation[i].busy) {
-			    cout << "Have Load " << i << endl;
-			    loadstation[i].busy = true;
-			    loadstation[i].station = i;
-			    currStation = &loadstation[i];
-			    newIssue = 1;
-			    break;
-			}
-		    }
-		    break;
-		case (StoreUnit):
-		    for (i = 0; i < numStoreRes; ++i) {
-			if (!storestation[i].busy) {
-			    cout << "Have Store" << endl;
-			    storestation[i].busy = true;
-			    storestation[i].station = i;
-			    currStation = &storestation[i];
-			    newIssue = 1;
-			    break;
-			}
-		    }
-		    break;
-		default:
-		    break;
+	currentInst = nextInst(sim);
+	if (sim -> keepIssue && (currentInst != NULL)) {
+	    i = allocStation(sim, currentInst -> funit);
+	    if (i >= 0) {
+		if (logOn(sim -> log, LOG_DEBUG, LOG_ISSUE)) {
+		    cout << "Have " << sim -> fuclass[currentInst -> funit].label << " " << i - sim -> fuclass[currentInst -> funit].base << endl;
+		}
+		rs.busy[i] = true;
+		currStation = i;
+		newIssue = 1;
+		if (sim -> recorder != NULL) {
+		    recordEvent(sim -> recorder, PE_ISSUE, sim -> clockcycles, currentInst -> seq, currentInst -> funit, i - sim -> fuclass[currentInst -> funit].base, currentInst -> opcode, 0, 0);
+		}
+		if (sim -> timeline != NULL) {
+		    timelineIssue(sim -> timeline, i, currentInst -> seq, currentInst -> opcode, currentInst -> funit, i - sim -> fuclass[currentInst -> funit].base, sim -> clockcycles);
+		}
 	    }
 	}
 
 	// If new issue, get ready for the next cycle
 	if (newIssue == 1) {
-	    roInst = currentInst;
+	    sim -> roSlot = sim -> windowHead;
 	    roStation = currStation;
-	    currentInst = currentInst -> next;
+	    popInst(sim);
 	    allowRO = 1;
 	    newIssue = 0;
+	    if (sim -> sample.detail > 0) {
+		countSample(sim);
+	    }
 	}
 	else if (currentInst != NULL){
-	    cout << "Stall" << endl;
-	    stalls++;
+	    if (logOn(sim -> log, LOG_DEBUG, LOG_ISSUE)) {
+		cout << "Stall" << endl;
+	    }
+	    (sim -> stalls)++;
+	    (sim -> issueStalls[currentInst -> funit])++;
+	    if (sim -> recorder != NULL) {
+		recordEvent(sim -> recorder, PE_STALL, sim -> clockcycles, currentInst -> seq, currentInst -> funit, 0, currentInst -> opcode, 0, 1);
+	    }
+	}
+	if (phases) {
+	    profCharge(prof, PROF_ISSUE);
 	}
 
-	cout.flush();
 	// Execute
-	for (i = 0; i < numIntRes; ++i) {
-	    exeStation = &intstation[i];
-	    if (exeStation -> execycles > 0) {
-		if (exeStation -> startexe < clockcycles) {
-		    (exeStation -> execycles)--;
+	for (w = 0; w < rs.busymask.size(); ++w) {
+	    bits = rs.busymask[w];
+	    while (bits) {
+		i = (w * 64) + __builtin_ctzll(bits);
+		bits &= bits - 1;
+		if (rs.execycles[i] > 0) {
+		    if (rs.startexe[i] < sim -> clockcycles) {
+			(rs.execycles[i])--;
+		    }
 		}
 	    }
 	}
-
-	for (i = 0; i < numDivRes; ++i) {
-	    exeStation = &divstation[i];
-	    if (exeStation -> execycles > 0) {
-		if (exeStation -> startexe < clockcycles) {
-		   (exeStation -> execycles)--;
-		}
-	    }
+	if (phases) {
+	    profCharge(prof, PROF_EXEC);
 	}
 
-	for (i = 0; i < numMultRes; ++i) {
-	    exeStation = &multstation[i];
-	    if (exeStation -> execycles > 0) {
-		if (exeStation -> startexe < clockcycles) {
-		   (exeStation -> execycles)--;
-		}
-	    }
+	// END
+	if (logOn(sim -> log, LOG_TRACE, LOG_EXEC)) {
+	    printStations(sim);
+	    cout << "Clock Cycles: " << sim -> clockcycles + 1 << endl << endl;
 	}
 
-	for (i = 0; i < numLoadRes; ++i) {
-	    exeStation = &loadstation[i];
-	    if (exeStation -> execycles > 0) {
-		if (exeStation -> startexe < clockcycles) {
-		    (exeStation -> execycles)--;
-		}
-	    }
+	(sim -> clockcycles)++;
+
+	if (checkFinish(sim)) {
+	    break;
 	}
 
-	for (i = 0; i < numStoreRes; ++i) {
-	    exeStation = &storestation[i];
-	    if (exeStation -> execycles > 0) {
-		if (exeStation -> startexe < clockcycles) {
-		    (exeStation -> execycles)--;
+	// Save the state between cycles, periodically or when signalled
+	if (sim -> checkpointFile != NULL) {
+	    if (checkpointSignal || ((sim -> checkpointInterval > 0) && (sim -> clockcycles >= sim -> nextCheckpoint))) {
+		if (!saveCheckpoint(sim, sim -> checkpointFile)) {
+		    cout << "Error Writing Checkpoint " << sim -> checkpointFile << endl;
+		}
+		else if (logOn(sim -> log, LOG_INFO, LOG_CONFIG)) {
+		    cout << "Checkpoint at cycle " << sim -> clockcycles << " written to " << sim -> checkpointFile << endl;
+		}
+		while ((sim -> checkpointInterval > 0) && (sim -> nextCheckpoint <= sim -> clockcycles)) {
+		    sim -> nextCheckpoint += sim -> checkpointInterval;
+		}
+		if (checkpointSignal == CKPT_STOP) {
+		    sim -> stopped = 1;
+		    break;
 		}
+		checkpointSignal = CKPT_NONE;
 	    }
 	}
+	if (phases) {
+	    profCharge(prof, PROF_FINISH);
+	}
+    }
 
-	// END
-#ifdef DEBUG
-	printStations();
-	cout << "Clock Cycles: " << clockcycles + 1 << endl << endl;
-#endif
+    prof -> simulate += profNow() - start;
 
-	clockcycles++;
+    return sim -> clockcycles;
+}
 
-	if (checkFinish()) {
-	    break;
-	}
-    }
+// Printable name of a tag
+string tagName(Simulator * sim, rstag tag) {
 
-    // Clear the list
-    clearInst();
+    int station;
+    int unit;
 
-    // Print some stuff
-    cout << endl << "Num Clock Cycles: " << clockcycles << endl;
-    printFU();
-    cout << "Register Reads: " << regreads << endl;
-    cout << "Pipeline Stall: " << stalls << endl;
+    if (tag == TAG_READY) {
+	return "";
+    }
+    if (tag & TAG_REGFILE) {
+	return "R" + to_string(tag & ~TAG_REGFILE);
+    }
 
-    // Write the output
-    writeResults(argv[3], clockcycles);
-
-    // Delete
-    delete[] intstation;
-    delete[] divstation;
-    delete[] multstation;
-    delete[] loadstation;
-    delete[] storestation;
-    delete[] FUIntData;
-    delete[] FUDivData;
-    delete[] FUMultData;
-    delete[] FULoadData;
-    delete[] FUStoreData;
+    station = tagStation(tag);
+    unit = sim -> rs.unit[station];
 
-    return 0;
+    return sim -> fuclass[unit].tag + to_string(station - sim -> fuclass[unit].base);
 }
 
 // Print the register renamed values
-void printrename() {
+void printrename(Simulator * sim) {
 
     for (int i = 0; i < NUMREGS; ++i) {
-	cout << "Reg" << i << "\t" << renamereg[i] << endl;
+	cout << "Reg" << i << "\t" << tagName(sim, sim -> renamereg[i]) << endl;
     }
 
     return;
 }
 
 // Search renamed registers for key value
-int findrename(string regName) {
+int findrename(Simulator * sim, int reg) {
 
-    if (renamereg[regName[1]-'0'].empty()) {
-	cout << regName << " : EMPTY" << endl;
+    if (sim -> renamereg[reg] == TAG_READY) {
+	if (logOn(sim -> log, LOG_DEBUG, LOG_RO)) {
+	    cout << "R" << reg << " : EMPTY" << endl;
+	}
 	return 0;
     }
-    else {	
-	cout << regName << " " << renamereg[regName[1] - '0'] << endl;
+    else {
+	if (logOn(sim -> log, LOG_DEBUG, LOG_RO)) {
+	    cout << "R" << reg << " " << tagName(sim, sim -> renamereg[reg]) << endl;
+	}
 	return 1;
     }
 
 }
 
-// Print the current status of all reservation stations
-void printStations() {
+// Read a source register, or wait on the station producing it
+void readOperand(Simulator * sim, int reg, int station, int operand) {
 
-    int i;
+    StationTable & rs = sim -> rs;
+    rstag producer;
+    waiter w;
 
-    cout << "OP\tBorn\tExe\tCyc\tUnit\tOP\tVj\tVk\tQj\tQk" << endl;
-    cout << "-----------------------------------------------------------------------" << endl;
+    if (findrename(sim, reg)) {
+	producer = sim -> renamereg[reg];
+	if (operand == 0) {
+	    rs.qj[station] = producer;
+	}
+	else {
+	    rs.qk[station] = producer;
+	}
 
-    for (i = 0; i < numLoadRes; ++i) {
-	cout << loadstation[i].busy << "\t" << loadstation[i].age << "\t" << loadstation[i].startexe << "\t" << loadstation[i].execycles << "\t" << loadstation[i].funit << "\t" << loadstation[i].op << "\t" << loadstation[i].vj << "\t" << loadstation[i].vk << "\t" << loadstation[i].qj << "\t " << loadstation[i].qk << endl;
+	// Woken up when the producer writes back
+	w.station = station;
+	w.operand = operand;
+	sim -> waitlist[tagStation(producer)].push_back(w);
     }
-    for (i = 0; i < numStoreRes; ++i) {
-	cout << storestation[i].busy << "\t" << storestation[i].age << "\t" << storestation[i].startexe << "\t" << storestation[i].execycles << "\t" << storestation[i].funit << "\t" << storestation[i].op << "\t" << storestation[i].vj << "\t" << storestation[i].vk << "\t" << storestation[i].qj << "\t " << storestation[i].qk << endl;
-    }
-    for (i = 0; i < numIntRes; ++i) {
-	cout << intstation[i].busy << "\t" << intstation[i].age << "\t" << intstation[i].startexe << "\t" << intstation[i].execycles << "\t" << intstation[i].funit << "\t" << intstation[i].op << "\t" << intstation[i].vj << "\t" << intstation[i].vk << "\t" << intstation[i].qj << "\t " << intstation[i].qk << endl;
-    }
-    for (i = 0; i < numDivRes; ++i) {
-	cout << divstation[i].busy << "\t" << divstation[i].age << "\t" << divstation[i].startexe << "\t" << divstation[i].execycles << "\t" << divstation[i].funit << "\t" << divstation[i].op << "\t" << divstation[i].vj << "\t" << divstation[i].vk << "\t" << divstation[i].qj << "\t" << divstation[i].qk << endl;
-    }
-    for (i = 0; i < numMultRes; ++i) {
-	cout << multstation[i].busy << "\t" << multstation[i].age << "\t" << multstation[i].startexe << "\t" << multstation[i].execycles << "\t" << multstation[i].funit << "\t" << multstation[i].op << "\t" << multstation[i].vj << "\t" << multstation[i].vk << "\t" << multstation[i].qj << "\t" << multstation[i].qk << endl;
+    else {
+	if (operand == 0) {
+	    rs.vj[station] = TAG_REGFILE | reg;
+	}
+	else {
+	    rs.vk[station] = TAG_REGFILE | reg;
+	}
+	(sim -> regreads)++;
     }
 
-    cout << "-----------------------------------------------------------------------" << endl;
     return;
 }
 
-// Check to see if instruction has all operands to execute
-void checkOperand(int clockcycles) {
+// Print the current status of all reservation stations
+void printStations(Simulator * sim) {
 
+    StationTable & rs = sim -> rs;
     int i;
 
-    for (i = 0; i < numIntRes; ++i) {
-	if (intstation[i].execycles < 0) {
-	    if ((intstation[i].qj.empty()) && (intstation[i].qk.empty())) {
-		intstation[i].execycles = intLatency;
-		intstation[i].startexe = clockcycles;
-	    }
-	}
-    }
-    checkFU(IntUnit, clockcycles);
-    for (i = 0; i < numDivRes; ++i) {
-	if (divstation[i].execycles < 0) {
-	    if ((divstation[i].qj.empty()) && (divstation[i].qk.empty())) {
-		divstation[i].execycles = divLatency;
-		divstation[i].startexe = clockcycles;
-	    }
-	}	
-    }
-    checkFU(DivUnit, clockcycles);
-    for (i = 0; i < numMultRes; ++i) {
-	if (multstation[i].execycles < 0) {
-	    if ((multstation[i].qj.empty()) && (multstation[i].qk.empty())) {
-		multstation[i].execycles = multLatency;
-		multstation[i].startexe = clockcycles;
-	    }
-	}	
-    }
-    checkFU(MultUnit, clockcycles);
-    for (i = 0; i < numLoadRes; ++i) {
-	if (loadstation[i].execycles < 0) {
-	    if ((loadstation[i].qj.empty()) && (loadstation[i].qk.empty())) {
-		loadstation[i].execycles = loadLatency;
-		loadstation[i].startexe = clockcycles;
-	    }
-	}
-    }
-    checkFU(LoadUnit, clockcycles);
+    cout << "OP\tBorn\tExe\tCyc\tUnit\tOP\tVj\tVk\tQj\tQk" << endl;
+    cout << "-----------------------------------------------------------------------" << endl;
 
-    for (i = 0; i < numStoreRes; ++i) {
-	if (storestation[i].execycles < 0) {
-	    if ((storestation[i].qj.empty()) && (storestation[i].qk.empty())) {
-		storestation[i].execycles = loadLatency;
-		storestation[i].startexe = clockcycles;
-	    }
+    for (size_t c = 0; c < sim -> fuclass.size(); ++c) {
+	for (i = sim -> fuclass[c].base; i < sim -> fuclass[c].base + sim -> fuclass[c].resnumber; ++i) {
+	    cout << (int) rs.busy[i] << "\t" << rs.age[i] << "\t" << rs.startexe[i] << "\t" << rs.execycles[i] << "\t" << rs.funit[i] << "\t" << (rs.busy[i] ? traceOpName(rs.op[i]) : "") << "\t" << tagName(sim, rs.vj[i]) << "\t" << tagName(sim, rs.vk[i]) << "\t" << tagName(sim, rs.qj[i]) << "\t" << tagName(sim, rs.qk[i]) << endl;
 	}
     }
-    checkFU(StoreUnit, clockcycles);
+
+    cout << "-----------------------------------------------------------------------" << endl;
+    return;
+}
+
+// Queue a station whose operands are all available
+void markReady(Simulator * sim, int station) {
+
+    sim -> rs.ready[station] = sim -> clockcycles;
+    sim -> readyq[sim -> rs.unit[station]].push(readyEntry(sim -> rs.age[station], station));
 
     return;
 }
 
 // Find the oldest instruction waiting to execute
-int findOldest(int unit, int numRes, int unitID, int latency, int clockcycles) {
+int findOldest(Simulator * sim, int unit, int unitID, int latency) {
 
-    idmstation * oldInst;
-    idmstation * checkRes;
-    int i;
+    int oldInst;
 
-    switch (unit) {
-	case (IntUnit):
-	    checkRes = &intstation[0];
-	    break;
-	case (DivUnit):
-	    checkRes = &divstation[0];
-	    break;
-	case (MultUnit):
-	    checkRes = &multstation[0];
-	    break;
-	case (LoadUnit):
-	    checkRes = &loadstation[0];
-	    break;
-	case (StoreUnit):
-	    checkRes = &storestation[0];
-	    break;
-	default:
-	    break;
+    if (sim -> readyq[unit].empty()) {
+	return 0;
     }
 
-    oldInst = NULL;
+    oldInst = sim -> readyq[unit].top().second;
+    sim -> readyq[unit].pop();
 
-    for (i = 0; i < numRes; ++i) {
-	if ((checkRes -> busy) && (checkRes -> funit == 0) && ((checkRes -> qj).empty()) && (checkRes -> qk).empty()) {
-	    if (oldInst == NULL) {
-		oldInst = checkRes;
-	    }
-	    if ((oldInst -> age) > (checkRes -> age)) {
-		oldInst = checkRes;
-	    }
-	}
-	checkRes = checkRes + 1;
+    sim -> unitWait[unit] += sim -> clockcycles - sim -> rs.ready[oldInst];
+    sim -> rs.startexe[oldInst] = sim -> clockcycles;
+    sim -> rs.execycles[oldInst] = latency;
+    sim -> rs.funit[oldInst] = unitID + 1;
+
+    if (sim -> recorder != NULL) {
+	recordEvent(sim -> recorder, PE_EXEC, sim -> clockcycles, sim -> rs.seq[oldInst], unit, oldInst - sim -> fuclass[unit].base, sim -> rs.op[oldInst], unitID, latency);
     }
 
-    if (oldInst != NULL) {
-	oldInst -> startexe = clockcycles;
-	oldInst -> execycles = latency;
-	oldInst -> funit = unitID + 1;
-	return 1;
+    if (sim -> timeline != NULL) {
+	timelineExec(sim -> timeline, oldInst, sim -> clockcycles, latency, unitID);
     }
 
-    return 0;
+    if (logOn(sim -> log, LOG_DEBUG, LOG_EXEC)) {
+	cout << "Exec " << tagName(sim, makeTag(oldInst)) << " " << traceOpName(sim -> rs.op[oldInst]) << " on " << sim -> fuclass[unit].label << "Unit " << unitID + 1 << endl;
+    }
+
+    return 1;
 }
 
 // Check functional unit
-void checkFU(int unit, int clockcycles){
+void checkFU(Simulator * sim, int unit){
 
-    int numUnits;
-    int latencyval;
-    int i;
-    int numRes;
-    int allowExe = 0;
+    FUClass & fc = sim -> fuclass[unit];
     FUInfo * fuptr;
+    int i;
 
-    switch (unit){
-	case (IntUnit):
-	    numUnits = numIntFU;
-	    numRes = numIntRes;
-	    fuptr = &FUIntData[0];
-	    latencyval = intLatency;
-	    break;
-	case (DivUnit):
-	    numUnits = numDivFU;
-	    numRes = numDivRes;
-	    fuptr = &FUDivData[0];
-	    latencyval = divLatency;
-	    break;
-	case (MultUnit):
-	    numUnits = numMultFU;
-	    numRes = numMultRes;
-	    fuptr = &FUMultData[0];
-	    latencyval = multLatency;
-	    break;
-	case (LoadUnit):
-	    numUnits = numLoadFU;
-	    numRes = numLoadRes;
-	    fuptr = &FULoadData[0];
-	    latencyval = loadLatency;
-	    break;
-	case (StoreUnit):
-	    numUnits = numStoreFU;
-	    numRes = numStoreRes;
-	    fuptr = &FUStoreData[0];
-	    latencyval = storeLatency;
-	    break;
-	default:
-	    break;
+    // Nothing waiting for a unit
+    if (sim -> readyq[unit].empty()) {
+	return;
     }
 
-    for (i = 0; i < numUnits; ++i) {
-	if (!(fuptr -> inUse)) {
-	    if(findOldest(unit, numRes, i, latencyval, clockcycles)) {
-		fuptr -> inUse = 1;
+    fuptr = &(sim -> fus[fc.fubase]);
+
+    // A pipelined unit takes a new instruction every ii cycles, any
+    // other is busy until its instruction writes back
+    for (i = 0; i < fc.number; ++i) {
+	if ((!(fuptr -> inUse)) && (fuptr -> nextFree <= sim -> clockcycles)) {
+	    if(findOldest(sim, unit, i, fc.latency)) {
+		if (fc.ii > 0) {
+		    fuptr -> nextFree = sim -> clockcycles + fc.ii;
+		    fuptr -> busyCycles += fc.ii;
+		}
+		else {
+		    fuptr -> inUse = 1;
+		    fuptr -> start = sim -> clockcycles;
+		}
 		(fuptr -> count)++;
 	    }
 	}
@@ -904,167 +866,440 @@ void checkFU(int unit, int clockcycles){
 }
 
 // Broadcast on CDB
-void writebackCDB(idmstation * cStation, string resID){
+void writebackCDB(Simulator * sim, int station){
 
-    int i;
+    StationTable & rs = sim -> rs;
+    vector<waiter> & waiting = sim -> waitlist[station];
+    rstag resID = makeTag(station);
+    FUInfo * fuptr;
+    int consumer;
 
-    for (i = 0; i < numIntRes; ++i) {
-	if (intstation[i].qj == resID) {
-	    intstation[i].vj = resID;
-	    intstation[i].qj.clear();
+    if (logOn(sim -> log, LOG_DEBUG, LOG_WB)) {
+	cout << "WB " << tagName(sim, resID) << " " << traceOpName(rs.op[station]) << " to " << waiting.size() << " waiting" << endl;
+    }
+
+    if (sim -> recorder != NULL) {
+	recordEvent(sim -> recorder, PE_WB, sim -> clockcycles, rs.seq[station], rs.unit[station], station - sim -> fuclass[rs.unit[station]].base, rs.op[station], rs.funit[station] - 1, 0);
+    }
+
+    if (sim -> timeline != NULL) {
+	timelineWriteback(sim -> timeline, station, sim -> clockcycles);
+    }
+
+    // Only the registered consumers see the broadcast
+    for (size_t i = 0; i < waiting.size(); ++i) {
+	consumer = waiting[i].station;
+	if (waiting[i].operand == 0) {
+	    rs.vj[consumer] = resID;
+	    rs.qj[consumer] = TAG_READY;
+	}
+	else {
+	    rs.vk[consumer] = resID;
+	    rs.qk[consumer] = TAG_READY;
 	}
-	if (intstation[i].qk == resID) {
-	    intstation[i].vk = resID;
-	    intstation[i].qk.clear();
+
+	// Last operand arrived, its producer is charged for the whole wait
+	// since issue, including cycles other producers were also pending
+	if ((rs.qj[consumer] == TAG_READY) && (rs.qk[consumer] == TAG_READY)) {
+	    sim -> operandWait[rs.unit[station]] += sim -> clockcycles - rs.age[consumer];
+	    markReady(sim, consumer);
 	}
     }
+    waiting.clear();
+
+    fuptr = &(sim -> fus[sim -> fuclass[rs.unit[station]].fubase + rs.funit[station] - 1]);
+    if (fuptr -> inUse) {
+	fuptr -> busyCycles += sim -> clockcycles - fuptr -> start;
+	fuptr -> inUse = 0;
+    }
+
+    if (rs.op[station] == N_HALT) {
+	sim -> keepIssue = 0;
+    }
+
+    rs.op[station] = 0;
+    rs.vj[station] = TAG_READY;
+    rs.vk[station] = TAG_READY;
+    rs.busy[station] = false;
+    releaseStation(sim, station);
+    rs.age[station] = 0;
+    rs.startexe[station] = 0;
+    rs.funit[station] = 0;
+
+    // Clear the rename unless a younger instruction renamed it again
+    if ((rs.dest[station] >= 0) && (sim -> renamereg[rs.dest[station]] == resID)) {
+	sim -> renamereg[rs.dest[station]] = TAG_READY;
+    }
+    rs.dest[station] = -1;
 
-    for (i = 0; i < numDivRes; ++i) {
-	if (divstation[i].qj == resID) {
-	    divstation[i].vj = resID;
-	    divstation[i].qj.clear();
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Outputs: Number of broadcasts this cycle
+// Description: Stations that finished execution compete for cdbWidth
+//		buses, oldest first. The others keep their station and
+//		unit and try again next cycle.
+// /////////////////////////////////////////////////////////////////
+int writebackLimited(Simulator * sim) {
+
+    StationTable & rs = sim -> rs;
+    vector<int> & finished = sim -> finished;
+    size_t width = sim -> cdbWidth;
+    size_t w;
+    uint64_t bits;
+    int i;
+
+    finished.clear();
+
+    for (w = 0; w < rs.busymask.size(); ++w) {
+	bits = rs.busymask[w];
+	while (bits) {
+	    i = (w * 64) + __builtin_ctzll(bits);
+	    bits &= bits - 1;
+	    if ((rs.execycles[i] == 0) && (rs.startexe[i] > 0)) {
+		finished.push_back(i);
+	    }
 	}
-	if (divstation[i].qk == resID) {
-	    divstation[i].vk = resID;
-	    divstation[i].qk.clear();
+    }
+
+    // Oldest first, then program order
+    if (finished.size() > width) {
+	partial_sort(finished.begin(), finished.begin() + width, finished.end(), [&rs](int a, int b) {
+	    return (rs.age[a] != rs.age[b]) ? (rs.age[a] < rs.age[b]) : (rs.seq[a] < rs.seq[b]);
+	});
+	sim -> cdbWait += finished.size() - width;
+	(sim -> cdbContention)++;
+	finished.resize(width);
+    }
+
+    for (w = 0; w < finished.size(); ++w) {
+	writebackCDB(sim, finished[w]);
+    }
+
+    return finished.size();
+}
+
+// Skip cycles in which nothing but execution countdown can happen.
+// Called at the start of a cycle with no instruction in read operand.
+// Returns the number of cycles skipped; the next cycle has a writeback.
+int skipIdle(Simulator * sim) {
+
+    StationTable & rs = sim -> rs;
+    instNode * next;
+    size_t w;
+    uint64_t bits;
+    int i;
+    int skip = 0;
+
+    // A station waiting to write back makes this cycle busy
+    for (w = 0; w < rs.busymask.size(); ++w) {
+	bits = rs.busymask[w];
+	while (bits) {
+	    i = (w * 64) + __builtin_ctzll(bits);
+	    bits &= bits - 1;
+	    if ((rs.execycles[i] == 0) && (rs.startexe[i] > 0)) {
+		return 0;
+	    }
+	    if (rs.execycles[i] > 0) {
+		if ((skip == 0) || (rs.execycles[i] < skip)) {
+		    skip = rs.execycles[i];
+		}
+	    }
 	}
     }
 
-    for (i = 0; i < numMultRes; ++i) {
-	if (multstation[i].qj == resID) {
-	    multstation[i].vj = resID;
-	    multstation[i].qj.clear();
+    // Nothing executing, let the cycle run normally
+    if (skip == 0) {
+	return 0;
+    }
+
+    // Stop where a pipelined unit frees up for a waiting station
+    for (size_t c = 0; c < sim -> fuclass.size(); ++c) {
+	if ((sim -> fuclass[c].ii == 0) || (sim -> readyq[c].empty())) {
+	    continue;
 	}
-	if (multstation[i].qk == resID) {
-	    multstation[i].vk = resID;
-	    multstation[i].qk.clear();
+	for (i = 0; i < sim -> fuclass[c].number; ++i) {
+	    uint64_t nextFree = sim -> fus[sim -> fuclass[c].fubase + i].nextFree;
+	    if (nextFree <= sim -> clockcycles) {
+		return 0;
+	    }
+	    if (nextFree - sim -> clockcycles < (uint64_t) skip) {
+		skip = nextFree - sim -> clockcycles;
+	    }
 	}
     }
 
-    for (i = 0; i < numLoadRes; ++i) {
-	if (loadstation[i].qj == resID) {
-	    loadstation[i].vj = resID;
-	    loadstation[i].qj.clear();
+    // Issue must be blocked on a full reservation station class
+    next = nextInst(sim);
+    if (sim -> keepIssue && (next != NULL)) {
+	if (sim -> fuclass[next -> funit].busy < sim -> fuclass[next -> funit].resnumber) {
+	    return 0;
 	}
     }
 
-    for (i = 0; i < numStoreRes; ++i) {
-	if (storestation[i].qj == resID) {
-	    storestation[i].vj = resID;
-	    storestation[i].qj.clear();
+    // Every skipped cycle counts down execution and stalls issue
+    for (w = 0; w < rs.busymask.size(); ++w) {
+	bits = rs.busymask[w];
+	while (bits) {
+	    i = (w * 64) + __builtin_ctzll(bits);
+	    bits &= bits - 1;
+	    if (rs.execycles[i] > 0) {
+		rs.execycles[i] -= skip;
+	    }
 	}
-	if (storestation[i].qk == resID) {
-	    storestation[i].vk = resID;
-	    storestation[i].qk.clear();
+    }
+
+    if (next != NULL) {
+	sim -> stalls += skip;
+	sim -> issueStalls[next -> funit] += skip;
+	if (sim -> recorder != NULL) {
+	    recordEvent(sim -> recorder, PE_STALL, sim -> clockcycles, next -> seq, next -> funit, 0, next -> opcode, 0, skip);
 	}
     }
 
-    switch (resID[0]) {
-	case 'D':
-	    FUDivData[(cStation -> funit) - 1].inUse = 0;
-	    break;
-	case 'I':
-	    FUIntData[(cStation -> funit) - 1].inUse = 0;
-	    break;
-	case 'L':
-	    FULoadData[(cStation -> funit) - 1].inUse = 0;
-	    break;
-	case 'M':	    
-	    FUMultData[(cStation -> funit) - 1].inUse = 0;
+    return skip;
+}
+
+// Ready the destination of a fast forwarded instruction
+inline void skipDest(Simulator * sim, int opcode, int reg) {
+
+    if ((opcode != N_SW) && (opcode != N_PUT) && (opcode != N_HALT)) {
+	sim -> renamereg[reg] = TAG_READY;
+    }
+
+    return;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Number of instructions to skip
+// Description: Skipped instructions take no time and their results
+//		are available at once, so the rename table stays warm:
+//		a register they write no longer waits on an older
+//		producer. Instructions in flight carry on untouched.
+//		HALT is never skipped.
+// /////////////////////////////////////////////////////////////////
+void fastForward(Simulator * sim, uint64_t count) {
+
+    const TraceRecord * rec;
+    instNode * node;
+    uint64_t done = 0;
+    int slot;
+
+    // Instructions already in the window
+    while ((done < count) && (sim -> windowCount > 0)) {
+	node = &(sim -> instWindow[sim -> windowHead]);
+	if (node -> opcode == N_HALT) {
 	    break;
-	case 'S':
-	    FUStoreData[(cStation -> funit) - 1].inUse = 0;
+	}
+	skipDest(sim, node -> opcode, node -> dest);
+	popInst(sim);
+	done++;
+    }
+
+    // Then straight from the trace, without building window entries
+    while ((done < count) && (!sim -> traceDone)) {
+	rec = nextRecord(sim);
+	if (rec == NULL) {
+	    sim -> traceDone = 1;
 	    break;
-	default:
+	}
+	(sim -> traceRead)++;
+
+	if (rec -> op == N_HALT) {
+	    slot = (sim -> windowHead + sim -> windowCount) % INST_WINDOW;
+	    addRecord(sim, &(sim -> instWindow[slot]), *rec);
+	    (sim -> windowCount)++;
+	    sim -> traceDone = 1;
 	    break;
+	}
+
+	(sim -> numInst)++;
+	skipDest(sim, rec -> op, rec -> rd);
+	done++;
     }
 
-    if (cStation -> op == "HALT") {
-	keepIssue = 0;
+    sim -> skipped += done;
+
+    return;
+}
+
+// Count an issued instruction towards the current sample
+void countSample(Simulator * sim) {
+
+    SampleConfig & sample = sim -> sample;
+
+    // First measured instruction
+    if (sim -> samplePos == (uint64_t) sample.warmup) {
+	sim -> sampleStart = sim -> clockcycles;
+	sim -> sampleStalls = sim -> stalls;
     }
 
-    (cStation -> op).clear();
-    (cStation -> vj).clear();
-    (cStation -> vk).clear();
-    cStation -> busy = false;
-    cStation -> age = 0;
-    cStation -> startexe = 0;
-    cStation -> funit = 0;
+    (sim -> samplePos)++;
 
-    for (i = 0; i < NUMREGS; ++i) {
-	if (renamereg[i] == resID) {
-	    renamereg[i].clear();
-	}
+    // Last measured instruction
+    if (sim -> samplePos == (uint64_t) (sample.warmup + sample.detail)) {
+	sim -> cpiSamples.push_back((sim -> clockcycles - sim -> sampleStart + 1) / (double) sample.detail);
+	sim -> spiSamples.push_back((sim -> stalls - sim -> sampleStalls) / (double) sample.detail);
     }
 
     return;
 }
 
-// Check to see if instruction finishes
-int checkFinish() {
+// Mean and 95% confidence half width of the samples, scaled
+void sampleEstimate(const vector<double> & samples, double scale, double * mean, double * ci) {
 
-    int i;
+    double sum = 0;
+    double sq = 0;
+    size_t n = samples.size();
 
-    for (i = 0; i < numIntRes; ++i) {
-	if (intstation[i].busy) {
-	    return 0;
-	}
-    }
+    *mean = 0;
+    *ci = 0;
 
-    for (i = 0; i < numDivRes; ++i) {
-	if (divstation[i].busy) {
-	    return 0;
-	}
+    if (n == 0) {
+	return;
     }
 
-    for (i = 0; i < numMultRes; ++i) {
-	if (multstation[i].busy) {
-	    return 0;
-	}
+    for (size_t i = 0; i < n; ++i) {
+	sum += samples[i];
     }
+    *mean = sum / n;
 
-    for (i = 0; i < numLoadRes; ++i) {
-	if (loadstation[i].busy) {
-	    return 0;
+    if (n > 1) {
+	for (size_t i = 0; i < n; ++i) {
+	    sq += (samples[i] - *mean) * (samples[i] - *mean);
 	}
+	*ci = 1.96 * sqrt(sq / (n - 1)) / sqrt((double) n) * scale;
     }
 
-    for (i = 0; i < numStoreRes; ++i) {
-	if (storestation[i].busy) {
-	    return 0;
+    *mean *= scale;
+
+    return;
+}
+
+// Claim the lowest free station of a class, -1 if all are busy
+int allocStation(Simulator * sim, int unit) {
+
+    FUClass & fc = sim -> fuclass[unit];
+    vector<uint64_t> & busymask = sim -> rs.busymask;
+    uint64_t freebits;
+    int i;
+
+    for (i = fc.base; i < fc.base + fc.resnumber; i += 64) {
+	freebits = ~busymask[i / 64];
+	if (freebits != 0) {
+	    i += __builtin_ctzll(freebits);
+	    if (i >= fc.base + fc.resnumber) {
+		return -1;
+	    }
+	    busymask[i / 64] |= (uint64_t) 1 << (i % 64);
+	    fc.busy++;
+	    (sim -> busyStations)++;
+	    return i;
 	}
     }
 
-    return 1;
+    return -1;
+}
 
+// Free a station after it writes back
+void releaseStation(Simulator * sim, int station) {
+
+    sim -> rs.busymask[station / 64] &= ~((uint64_t) 1 << (station % 64));
+    sim -> fuclass[sim -> rs.unit[station]].busy--;
+    (sim -> busyStations)--;
+
+    return;
 }
 
-// Print the Functional Unit
-void printFU() {
+// Check to see if instruction finishes
+int checkFinish(Simulator * sim) {
 
-    int i = 0;
+    return (sim -> busyStations == 0);
 
-    for (i = 0; i < numIntFU; ++i) {
-	cout << "IntUnit " << i+1 << "\t" << FUIntData[i].count << endl;
-    }
-    for (i = 0; i < numDivFU; ++i) {
-	cout << "DivUnit " << i+1 << "\t" << FUDivData[i].count << endl;
+}
+
+// Lay out the station and FU tables for the configured classes
+void initStations(Simulator * sim) {
+
+    StationTable & rs = sim -> rs;
+    vector<FUClass> & fuclass = sim -> fuclass;
+    int size = 0;
+    int units = 0;
+    int i;
+
+    for (size_t c = 0; c < fuclass.size(); ++c) {
+	fuclass[c].base = size;
+	fuclass[c].fubase = units;
+	fuclass[c].busy = 0;
+	size += ((fuclass[c].resnumber + 63) / 64) * 64;
+	units += fuclass[c].number;
     }
-    for (i = 0; i < numMultFU; ++i) {
-	cout << "MultUnit " << i+1 << "\t" << FUMultData[i].count << endl;
+
+    rs.size = size;
+    rs.busy.assign(size, 0);
+    rs.execycles.assign(size, 0);
+    rs.age.assign(size, 0);
+    rs.startexe.assign(size, 0);
+    rs.ready.assign(size, 0);
+    rs.funit.assign(size, 0);
+    rs.unit.assign(size, 0);
+    rs.op.assign(size, 0);
+    rs.seq.assign(size, 0);
+    rs.vj.assign(size, TAG_READY);
+    rs.vk.assign(size, TAG_READY);
+    rs.qj.assign(size, TAG_READY);
+    rs.qk.assign(size, TAG_READY);
+    rs.dest.assign(size, -1);
+    rs.busymask.assign(size / 64, 0);
+
+    for (size_t c = 0; c < fuclass.size(); ++c) {
+	for (i = fuclass[c].base; i < fuclass[c].base + fuclass[c].resnumber; ++i) {
+	    rs.unit[i] = c;
+	}
     }
-    for (i = 0; i < numLoadFU; ++i) {
-	cout << "LoadUnit " << i+1 << "\t" << FULoadData[i].count << endl;
+
+    for (i = 0; i < NUMREGS; ++i) {
+	sim -> renamereg[i] = TAG_READY;
     }
-    for (i = 0; i < numStoreFU; ++i) {
-	cout << "StoreUnit " << i+1 << "\t" << FUStoreData[i].count << endl;
+
+    sim -> clockcycles = 0;	// Set clock cycles
+    sim -> regreads = 0;	// Set register reads
+    sim -> keepIssue = 1;	// Flag
+    sim -> allowRO = 0;
+    sim -> roStation = -1;
+    sim -> nextCheckpoint = sim -> checkpointInterval;
+    sim -> cdbWait = 0;
+    sim -> cdbContention = 0;
+    sim -> cdbHist.assign(sim -> cdbWidth + 1, 0);
+    sim -> issueStalls.assign(fuclass.size(), 0);
+    sim -> operandWait.assign(fuclass.size(), 0);
+    sim -> unitWait.assign(fuclass.size(), 0);
+
+    sim -> waitlist.assign(size, vector<waiter>());
+    sim -> readyq.assign(fuclass.size(), readyQueue());
+    sim -> fus.assign(units, FUInfo());
+    sim -> busyStations = 0;
+
+    return;
+}
+
+// Print the Functional Unit
+void printFU(Simulator * sim) {
+
+    vector<FUClass> & fuclass = sim -> fuclass;
+
+    for (size_t c = 0; c < fuclass.size(); ++c) {
+	for (int i = 0; i < fuclass[c].number; ++i) {
+	    cout << fuclass[c].label << "Unit " << i+1 << "\t" << sim -> fus[fuclass[c].fubase + i].count << endl;
+	}
     }
 
     return;
 }
 
 // Read the configuration file
-void readConfig(char filename[FILE_SIZE]) {
+int readConfig(Simulator * sim, const char * filename) {
 
     ifstream configfile;
     Json::Value root;
@@ -1073,116 +1308,260 @@ void readConfig(char filename[FILE_SIZE]) {
 
     if (!configfile.is_open()) {
 	cout << "Error Reading Configuration File ... Terminating" << endl;
+	return 0;
     }
 
     configfile >> root;
 
-    const Json::Value& IntegerVals = root["integer"];
-    const Json::Value& DividerVals = root["divider"];
-    const Json::Value& MultiplierVals = root["multiplier"];
-    const Json::Value& LoadVals = root["load"];
-    const Json::Value& StoreVals = root["store"];
+    return parseConfig(sim, root);
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Configuration as JSON
+// Outputs: 1 if the configuration was applied
+// Description: Sets up the FU classes and the instructions they run
+// /////////////////////////////////////////////////////////////////
+int parseConfig(Simulator * sim, const Json::Value & root) {
+
+    // Built in classes, the instructions they execute by default come
+    // from the opcode table
+    static const char * names[NumBuiltin] = {"integer", "divider", "multiplier", "load", "store"};
+    static const char * labels[NumBuiltin] = {"Int", "Div", "Mult", "Load", "Store"};
+    static const char * tags[NumBuiltin] = {"INT", "DIV", "MULT", "LD", "STORE"};
+
+    vector<FUClass> & fuclass = sim -> fuclass;
+    FUClass fc;
+    int op;
+
+    if (!root.isObject()) {
+	cout << "Configuration is not a JSON object" << endl;
+	return 0;
+    }
+
+    fuclass.clear();
+    // Built in classes come first, in FUnits order
+    for (int c = 0; c < X_OPCODES; ++c) {
+	if (xOpTable[c].format >= XF_R) {
+	    sim -> opclass[xOpTable[c].op] = xOpTable[c].unit;
+	}
+    }
 
-    numIntFU = IntegerVals["number"].asInt();
-    numIntRes = IntegerVals["resnumber"].asInt();
-    intLatency = IntegerVals["latency"].asInt();
+    for (int c = 0; c < NumBuiltin; ++c) {
+	fc.name = names[c];
+	fc.label = labels[c];
+	fc.tag = tags[c];
+	fuclass.push_back(fc);
+    }
+
+    // Any other object listing "ops" adds a class for those instructions
+    Json::Value::Members members = root.getMemberNames();
+    for (size_t m = 0; m < members.size(); ++m) {
+	const Json::Value & vals = root[members[m]];
+	if ((vals.isObject()) && (vals.isMember("ops"))) {
+	    int c = 0;
+	    while ((c < NumBuiltin) && (members[m] != names[c])) {
+		c++;
+	    }
+	    if (c == NumBuiltin) {
+		fc.name = members[m];
+		fc.label = members[m];
+		fc.tag = vals.get("tag", members[m]).asString();
+		fuclass.push_back(fc);
+	    }
+	}
+    }
 
-    numDivFU = DividerVals["number"].asInt();
-    numDivRes = DividerVals["resnumber"].asInt();
-    divLatency = DividerVals["latency"].asInt();
+    for (size_t c = 0; c < fuclass.size(); ++c) {
+	const Json::Value & vals = root[fuclass[c].name];
 
-    numMultFU = MultiplierVals["number"].asInt();
-    numMultRes = MultiplierVals["resnumber"].asInt();
-    multLatency = MultiplierVals["latency"].asInt();
+	fuclass[c].number = vals["number"].asInt();
+	fuclass[c].resnumber = vals["resnumber"].asInt();
+	fuclass[c].latency = vals["latency"].asInt();
+	fuclass[c].ii = vals["pipelined"].asBool() ? 1 : vals["ii"].asInt();
 
-    numLoadFU = LoadVals["number"].asInt();
-    numLoadRes = LoadVals["resnumber"].asInt();
-    loadLatency = LoadVals["latency"].asInt();
+	const Json::Value & ops = vals["ops"];
+	for (Json::ArrayIndex n = 0; n < ops.size(); ++n) {
+	    op = traceOpCode(ops[n].asString());
+	    if (op < 0) {
+		cout << "Unknown instruction " << ops[n].asString() << " in " << fuclass[c].name << endl;
+		continue;
+	    }
+	    sim -> opclass[op] = c;
+	}
 
-    numStoreFU = StoreVals["number"].asInt();
-    numStoreRes = StoreVals["resnumber"].asInt();
-    storeLatency = StoreVals["latency"].asInt();
+	if (logOn(sim -> log, LOG_DEBUG, LOG_CONFIG)) {
+	    cout << vals << endl;
+	}
+    }
 
-    cout << IntegerVals << endl;
-    cout << DividerVals << endl;
-    cout << MultiplierVals << endl;
-    cout << LoadVals << endl;
-    cout << StoreVals << endl;
+    // Result buses, unlimited unless given
+    sim -> cdbWidth = root["cdb"].get("width", 0).asInt();
+    if (sim -> cdbWidth < 0) {
+	cout << "CDB width must be 0 (unlimited) or more" << endl;
+	return 0;
+    }
 
-    cout << "Int Info: " << numIntFU << "\t" << numIntRes << "\t" << intLatency << endl;
-    cout << "Div Info: " << numDivFU << "\t" << numDivRes << "\t" << divLatency << endl;
-    cout << "Mul Info: " << numMultFU << "\t" << numMultRes << "\t" << multLatency << endl;
-    cout << "Load Info: " << numLoadFU << "\t" << numLoadRes << "\t" << loadLatency << endl;
-    cout << "Store Info: " << numStoreFU << "\t" << numStoreRes << "\t" << storeLatency << endl;
+    if (logOn(sim -> log, LOG_INFO, LOG_CONFIG)) {
+	for (size_t c = 0; c < fuclass.size(); ++c) {
+	    cout << fuclass[c].label << " Info: " << fuclass[c].number << "\t" << fuclass[c].resnumber << "\t" << fuclass[c].latency << endl;
+	}
+    }
 
-    return;
+    return 1;
 }
 
-// Write the results
-void writeResults(char * filename, int clockcycles) {
+// Peak resident set of the process in kilobytes
+long peakRSS() {
 
-    ofstream outfile;
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+	return 0;
+    }
+
+    return usage.ru_maxrss;
+}
+
+// Statistics of a finished run
+Json::Value makeResults(Simulator * sim) {
+
+    static const char * phaseNames[PROF_NUM] = {"load", "config", "skip idle", "read operand", "writeback", "checkFU", "issue", "execute", "checkFinish", "results"};
+
+    vector<FUClass> & fuclass = sim -> fuclass;
+    Profile * prof = &(sim -> profile);
     Json::Value val_obj;
-    Json::Value int_arr(Json::arrayValue);
-    Json::Value div_arr(Json::arrayValue);
-    Json::Value mul_arr(Json::arrayValue);
-    Json::Value st_arr(Json::arrayValue);
-    Json::Value ld_arr(Json::arrayValue);
     Json::Value array;
-    Json::StyledWriter styledWriter;
+    Json::Value timing;
+    Json::Value phase;
+    double mean;
+    double ci;
 
     int i;
 
-    for (i = 0; i < numIntFU; ++i) {
-	val_obj["id"] = i;
-	val_obj["instructions"] = FUIntData[i].count;
-	int_arr.append(val_obj);
-    }
+    for (size_t c = 0; c < fuclass.size(); ++c) {
+	Json::Value fu_arr(Json::arrayValue);
 
-    val_obj.clear();
+	for (i = 0; i < fuclass[c].number; ++i) {
+	    FUInfo & fu = sim -> fus[fuclass[c].fubase + i];
+	    uint64_t busy = fu.busyCycles;
 
-    for (i = 0; i < numDivFU; ++i) {
-	val_obj["id"] = i;
-	val_obj["instructions"] = FUDivData[i].count;
-	div_arr.append(val_obj);
-    }
+	    // Time still running at the end, counted to the last cycle
+	    if (fu.inUse) {
+		busy += sim -> clockcycles - fu.start;
+	    }
+	    else if (fu.nextFree > sim -> clockcycles) {
+		busy -= fu.nextFree - sim -> clockcycles;
+	    }
 
-    val_obj.clear();
+	    val_obj["id"] = i;
+	    val_obj["instructions"] = fu.count;
+	    val_obj["busy cycles"] = (Json::UInt64) busy;
+	    val_obj["utilization"] = (sim -> clockcycles > 0) ? busy / (double) sim -> clockcycles : 0.0;
+	    fu_arr.append(val_obj);
+	}
 
-    for (i = 0; i < numMultFU; ++i) {
-	val_obj["id"] = i;
-	val_obj["instructions"] = FUMultData[i].count;
-	mul_arr.append(val_obj);
+	val_obj.clear();
+	array[fuclass[c].name] = fu_arr;
     }
 
-    val_obj.clear();
+    array["cycles"] = (Json::UInt64) sim -> clockcycles;
+    array["instructions"] = (Json::UInt64) sim -> numInst;
+    array["reg reads"] = (Json::UInt64) sim -> regreads;
+    array["stalls"] = (Json::UInt64) sim -> stalls;
+
+    // Sampled runs report totals extrapolated from the samples
+    if ((sim -> skipped > 0) && (!sim -> cpiSamples.empty())) {
+	sampleEstimate(sim -> cpiSamples, sim -> numInst, &mean, &ci);
+	array["cycles"] = (Json::UInt64) (mean + 0.5);
+	array["cycles ci95"] = ci;
+	sampleEstimate(sim -> spiSamples, sim -> numInst, &mean, &ci);
+	array["stalls"] = (Json::UInt64) (mean + 0.5);
+	array["stalls ci95"] = ci;
+	array["detailed cycles"] = (Json::UInt64) sim -> clockcycles;
+	array["detailed stalls"] = (Json::UInt64) sim -> stalls;
+	array["samples"] = (Json::UInt) sim -> cpiSamples.size();
+	array["fast forwarded instructions"] = (Json::UInt64) sim -> skipped;
+    }
 
-    for (i = 0; i < numLoadFU; ++i) {
-	val_obj["id"] = i;
-	val_obj["instructions"] = FULoadData[i].count;
-	ld_arr.append(val_obj);
+    // Issue cycles, stalls on each class's full stations and the drain
+    // after the last issue, per detailed instruction
+    Json::Value stack;
+    Json::Value stalled;
+    Json::Value operand;
+    Json::Value waitunit;
+    Json::Value waits;
+    uint64_t issued = sim -> numInst - sim -> skipped;
+    if (issued > 0) {
+	stack["cpi"] = sim -> clockcycles / (double) issued;
+	stack["base"] = 1.0;
+	for (size_t c = 0; c < fuclass.size(); ++c) {
+	    stalled[fuclass[c].name] = sim -> issueStalls[c] / (double) issued;
+	}
+	stack["issue stall"] = stalled;
+	stack["drain"] = (sim -> clockcycles - (double) issued - sim -> stalls) / issued;
+	array["cpi stack"] = stack;
     }
 
-    val_obj.clear();
+    // Where instructions waited once issued, raw cycles that overlap
+    // each other and issue, so they are kept out of the cpi stack
+    for (size_t c = 0; c < fuclass.size(); ++c) {
+	operand[fuclass[c].name] = (Json::UInt64) sim -> operandWait[c];
+	waitunit[fuclass[c].name] = (Json::UInt64) sim -> unitWait[c];
+    }
+    waits["operand"] = operand;
+    waits["unit"] = waitunit;
+    waits["cdb"] = (Json::UInt64) sim -> cdbWait;
+    array["wait cycles"] = waits;
+
+    // Common data bus
+    Json::Value cdb;
+    Json::Value hist(Json::arrayValue);
+    for (size_t n = 0; n < sim -> cdbHist.size(); ++n) {
+	hist.append((Json::UInt64) sim -> cdbHist[n]);
+    }
+    cdb["width"] = sim -> cdbWidth;
+    cdb["wait cycles"] = (Json::UInt64) sim -> cdbWait;
+    cdb["contention cycles"] = (Json::UInt64) sim -> cdbContention;
+    cdb["broadcasts"] = hist;
+    array["cdb"] = cdb;
+
+    // Host time
+    if (prof -> simulate > 0) {
+	array["sim cycles per second"] = sim -> clockcycles / (prof -> simulate / 1e9);
+	array["sim instructions per second"] = sim -> numInst / (prof -> simulate / 1e9);
+    }
 
-    for (i = 0; i < numStoreFU; ++i) {
-	val_obj["id"] = i;
-	val_obj["instructions"] = FUStoreData[i].count;
-	st_arr.append(val_obj);
+    timing["load"] = prof -> ns[PROF_LOAD] / 1e9;
+    timing["config"] = prof -> ns[PROF_CONFIG] / 1e9;
+    timing["simulate"] = prof -> simulate / 1e9;
+    timing["peak rss kb"] = (Json::Int64) peakRSS();
+    if (prof -> phases) {
+	for (i = PROF_SKIP; i <= PROF_FINISH; ++i) {
+	    phase[phaseNames[i]] = prof -> ns[i] / 1e9;
+	}
+	timing["phases"] = phase;
     }
+    array["profile"] = timing;
+
+    return array;
+}
+
+// Write the results
+void writeResults(Simulator * sim, const char * filename) {
+
+    ofstream outfile;
+    Json::StyledWriter styledWriter;
+    Json::Value results;
+    uint64_t start = profNow();
 
-    array["cycles"] = clockcycles;
-    array["integer"] = int_arr;
-    array["multiplier"] = mul_arr;
-    array["divider"] = div_arr;
-    array["store"] = st_arr;
-    array["load"] = ld_arr;
-    array["reg reads"] = regreads;
-    array["stalls"] = stalls;
+    // Building the results is timed, writing the file can not be
+    results = makeResults(sim);
+    sim -> profile.ns[PROF_RESULTS] = profNow() - start;
+    results["profile"]["results"] = sim -> profile.ns[PROF_RESULTS] / 1e9;
 
     outfile.open(filename);
 
-    outfile << styledWriter.write(array);
+    outfile << styledWriter.write(results);
 
     outfile.close();
 
@@ -0,0 +1,252 @@
+// ////////////////////////////////////////////////////////
+// File: tquery.cpp
+// Description: Prints slices of instruction timelines
+//		recorded by tomsim -t, or a summary of the
+//		time spent in each stage
+// ////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "timeline.h"
+#include "tracefile.h"
+
+using namespace std;
+
+// Rows to print
+struct Query {
+    uint64_t first = 0;			// First row
+    uint64_t count = UINT64_MAX;	// Rows from first
+    uint64_t from = 0;			// Cycle range the row must overlap
+    uint64_t to = UINT64_MAX;
+    int op = -1;			// Instruction, -1 for any
+    int unit = -1;			// FU class, -1 for any
+};
+
+// Stage times of a class
+struct StageSum {
+    uint64_t rows = 0;
+    uint64_t read = 0;			// Issue to read operand
+    uint64_t wait = 0;			// Read operand to execution start
+    uint64_t exec = 0;			// Execution
+    uint64_t cdb = 0;			// Execution end to writeback
+};
+
+// Row matches the query filters
+int matches(const Query & q, const TimelineRow & row) {
+
+    if ((q.op >= 0) && (row.op != q.op)) {
+	return 0;
+    }
+
+    if ((q.unit >= 0) && (row.unit != q.unit)) {
+	return 0;
+    }
+
+    return (row.issue <= q.to) && (row.wb >= q.from);
+}
+
+// Parse a comma separated list of column names
+int parseFields(const char * text, vector<int> * fields) {
+
+    string list = text;
+    string item;
+    size_t start = 0;
+    size_t end;
+    int f;
+
+    fields -> clear();
+
+    while (start < list.size()) {
+	end = list.find(',', start);
+	if (end == string::npos) {
+	    end = list.size();
+	}
+	item = list.substr(start, end - start);
+	start = end + 1;
+
+	for (f = 0; f < TL_NUM; ++f) {
+	    if (item == timelineNames[f]) {
+		break;
+	    }
+	}
+	if (f == TL_NUM) {
+	    return 0;
+	}
+	fields -> push_back(f);
+    }
+
+    return !fields -> empty();
+}
+
+// One row, instructions and classes by name
+void printRow(const TimelineRow & row, const vector<int> & fields, const vector<string> & labels) {
+
+    for (size_t i = 0; i < fields.size(); ++i) {
+	if (i > 0) {
+	    cout << "\t";
+	}
+	if (fields[i] == TL_OP) {
+	    cout << traceOpName(row.op);
+	}
+	else if (fields[i] == TL_UNIT) {
+	    cout << ((row.unit < labels.size()) ? labels[row.unit] : to_string(row.unit));
+	}
+	else {
+	    cout << timelineValue(row, fields[i]);
+	}
+    }
+    cout << "\n";
+
+    return;
+}
+
+// Average cycles per stage of each class
+void printSummary(const vector<StageSum> & sums, const vector<string> & labels) {
+
+    cout << "class\trows\tissue-read\tread-exec\texec\texec-wb" << endl;
+
+    for (size_t c = 0; c < sums.size(); ++c) {
+	const StageSum & s = sums[c];
+	if (s.rows == 0) {
+	    continue;
+	}
+	cout << labels[c] << "\t" << s.rows << "\t" << s.read / (double) s.rows << "\t" << s.wait / (double) s.rows << "\t" << s.exec / (double) s.rows << "\t" << s.cdb / (double) s.rows << endl;
+    }
+
+    return;
+}
+
+int main (int argc, char *argv[]) {
+
+    TimelineReader timeline;		// Input timeline
+    vector<TimelineRow> rows;		// Rows of one group
+    vector<int> fields;			// Columns to print
+    vector<StageSum> sums;		// Stage times per class
+    Query q;				// Rows to print
+    int summary = 0;			// Print stage times instead of rows
+    char * unitname = NULL;		// FU class label to print
+    uint64_t group;			// Current group
+    uint64_t last;			// One past the last row
+    uint64_t row;			// Row number
+    int opt;				// Command line option
+
+    for (int f = 0; f < TL_NUM; ++f) {
+	fields.push_back(f);
+    }
+
+    // Read options
+    while ((opt = getopt(argc, argv, "s:n:c:o:u:f:S")) != -1) {
+	switch (opt) {
+	    case ('s'):
+		q.first = strtoull(optarg, NULL, 10);
+		break;
+	    case ('n'):
+		q.count = strtoull(optarg, NULL, 10);
+		break;
+	    case ('c'):
+		if (sscanf(optarg, "%" SCNu64 ",%" SCNu64, &q.from, &q.to) != 2) {
+		    cout << "Cycle range is -c from,to" << endl;
+		    return -1;
+		}
+		break;
+	    case ('o'):
+		q.op = traceOpCode(optarg);
+		if (q.op < 0) {
+		    cout << "Unknown instruction " << optarg << endl;
+		    return -1;
+		}
+		break;
+	    case ('u'):
+		unitname = optarg;
+		break;
+	    case ('f'):
+		if (!parseFields(optarg, &fields)) {
+		    cout << "Unknown field in " << optarg << " (seq, issue, read, exec, done, wb, station, fu, op, unit)" << endl;
+		    return -1;
+		}
+		break;
+	    case ('S'):
+		summary = 1;
+		break;
+	    default:
+		cout << "Invalid Usage...\n\t" << argv[0] << " [-s first] [-n count] [-c from,to] [-o op] [-u class_label] [-f fields] [-S] timeline_file" << endl;
+		return -1;
+	}
+    }
+
+    if (argc - optind != 1) {
+	cout << "Invalid Usage...\n\t" << argv[0] << " [-s first] [-n count] [-c from,to] [-o op] [-u class_label] [-f fields] [-S] timeline_file" << endl;
+	return -1;
+    }
+
+    if (!openTimelineReader(&timeline, argv[optind])) {
+	cout << argv[optind] << " is not a timeline" << endl;
+	return -1;
+    }
+
+    // Classes by label
+    if (unitname != NULL) {
+	for (size_t c = 0; c < timeline.labels.size(); ++c) {
+	    if (timeline.labels[c] == unitname) {
+		q.unit = c;
+	    }
+	}
+	if (q.unit < 0) {
+	    cout << "Unknown class " << unitname << endl;
+	    return -1;
+	}
+    }
+
+    sums.resize(timeline.labels.size());
+
+    last = (q.count > timeline.rows - min(q.first, timeline.rows)) ? timeline.rows : q.first + q.count;
+
+    if (!summary) {
+	for (size_t i = 0; i < fields.size(); ++i) {
+	    cout << (i ? "\t" : "") << timelineNames[fields[i]];
+	}
+	cout << "\n";
+    }
+
+    // Only the groups holding the slice are read
+    for (group = q.first / timeline.groupRows; group * timeline.groupRows < last; ++group) {
+	if (!readTimelineGroup(&timeline, group, &rows)) {
+	    cout << argv[optind] << " is damaged at group " << group << endl;
+	    return -1;
+	}
+
+	for (size_t r = 0; r < rows.size(); ++r) {
+	    row = group * timeline.groupRows + r;
+	    if ((row < q.first) || (row >= last) || (!matches(q, rows[r]))) {
+		continue;
+	    }
+
+	    if (summary) {
+		if (rows[r].unit < sums.size()) {
+		    StageSum & s = sums[rows[r].unit];
+		    s.rows++;
+		    s.read += rows[r].read - rows[r].issue;
+		    s.wait += rows[r].exec - rows[r].read;
+		    s.exec += rows[r].done - rows[r].exec;
+		    s.cdb += rows[r].wb - rows[r].done;
+		}
+	    }
+	    else {
+		printRow(rows[r], fields, timeline.labels);
+	    }
+	}
+    }
+
+    if (summary) {
+	printSummary(sums, timeline.labels);
+    }
+
+    return 0;
+}
@@ -0,0 +1,248 @@
+// ////////////////////////////////////////////////////////
+// File: tracegen.cpp
+// Description: Generates synthetic traces with a chosen
+//		instruction mix, dependency chain length,
+//		instruction level parallelism and register
+//		pressure
+// ////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <string>
+
+#include "tracefile.h"
+
+#define NUMREGS 8
+
+using namespace std;
+
+// Instruction groups of the mix
+enum MixGroup {MIX_INT, MIX_IMM, MIX_MUL, MIX_DIV, MIX_LOAD, MIX_STORE, MIX_PUT, MIX_NUM};
+
+static const char * mixNames[MIX_NUM] = {"int", "imm", "mul", "div", "load", "store", "put"};
+
+// Generator state, xorshift64* so traces match on every host
+uint64_t rngState = 1;
+
+uint64_t rng() {
+
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+
+    return rngState * 0x2545F4914F6CDD1DULL;
+}
+
+// /////////////////////////////////////////////////////////////////
+// Inputs: Mix such as "int=50,mul=10,load=20"
+// Outputs: 1 and the weights, 0 if a group is unknown
+// Description: Groups not listed get weight 0
+// /////////////////////////////////////////////////////////////////
+int parseMix(const char * text, int weights[MIX_NUM]) {
+
+    string list = text;
+    string item;
+    size_t start = 0;
+    size_t end;
+    size_t eq;
+    int g;
+
+    memset(weights, 0, MIX_NUM * sizeof(int));
+
+    while (start < list.size()) {
+	end = list.find(',', start);
+	if (end == string::npos) {
+	    end = list.size();
+	}
+	item = list.substr(start, end - start);
+	start = end + 1;
+
+	eq = item.find('=');
+	for (g = 0; g < MIX_NUM; ++g) {
+	    if (item.substr(0, eq) == mixNames[g]) {
+		break;
+	    }
+	}
+	if ((g == MIX_NUM) || (eq == string::npos)) {
+	    return 0;
+	}
+	weights[g] = atoi(item.c_str() + eq + 1);
+    }
+
+    return 1;
+}
+
+// Pick a group with probability proportional to its weight
+int pickGroup(const int weights[MIX_NUM], int total) {
+
+    int r = rng() % total;
+    int g;
+
+    for (g = 0; g < MIX_NUM - 1; ++g) {
+	if (r < weights[g]) {
+	    break;
+	}
+	r -= weights[g];
+    }
+
+    return g;
+}
+
+int main (int argc, char *argv[]) {
+
+    TraceWriter trace;			// Output trace
+    TraceRecord rec;			// Current instruction
+    int weights[MIX_NUM];		// Instruction mix
+    int total;				// Sum of the weights
+    uint64_t count = 1000;		// Instructions before HALT
+    int chain = 8;			// Dependent instructions per chain
+    int ilp = 1;			// Independent chains in flight
+    int regs = NUMREGS;		// Architectural registers used
+    int format = TRACE_BINARY;		// TraceFormat written
+    int opt;				// Command line option
+    uint64_t n;				// Counting variable
+    int c;				// Chain of the instruction
+    int pos;				// Position in the chain
+    int reg;				// Chain register
+    int other;				// Register from outside the chain
+
+    parseMix("int=50,imm=10,mul=10,div=5,load=15,store=10", weights);
+
+    // Read options
+    while ((opt = getopt(argc, argv, "n:m:c:i:r:s:tz")) != -1) {
+	switch (opt) {
+	    case ('n'):
+		count = strtoull(optarg, NULL, 10);
+		break;
+	    case ('m'):
+		if (!parseMix(optarg, weights)) {
+		    cout << "Unknown mix " << optarg << " (int, imm, mul, div, load, store, put)" << endl;
+		    return -1;
+		}
+		break;
+	    case ('c'):
+		chain = atoi(optarg);
+		break;
+	    case ('i'):
+		ilp = atoi(optarg);
+		break;
+	    case ('r'):
+		regs = atoi(optarg);
+		break;
+	    case ('s'):
+		rngState = strtoull(optarg, NULL, 10) * 2 + 1;
+		break;
+	    case ('t'):
+		format = TRACE_TEXT;
+		break;
+	    case ('z'):
+		format = TRACE_PACKED;
+		break;
+	    default:
+		cout << "Invalid Usage...\n\t" << argv[0] << " [-n count] [-m mix] [-c chain] [-i ilp] [-r regs] [-s seed] [-t | -z] output_trace" << endl;
+		return -1;
+	}
+    }
+
+    if (argc - optind != 1) {
+	cout << "Invalid Usage...\n\t" << argv[0] << " [-n count] [-m mix] [-c chain] [-i ilp] [-r regs] [-s seed] [-t | -z] output_trace" << endl;
+	return -1;
+    }
+
+    total = 0;
+    for (int g = 0; g < MIX_NUM; ++g) {
+	total += weights[g];
+    }
+
+    if ((total <= 0) || (chain < 1) || (ilp < 1) || (regs < 1) || (regs > NUMREGS)) {
+	cout << "Mix must have a weight, chain and ilp must be at least 1, regs 1 to " << NUMREGS << endl;
+	return -1;
+    }
+
+    if (!openTraceWriter(&trace, argv[optind], format)) {
+	cout << "Output file not open...terminating" << endl;
+	return -1;
+    }
+
+    // Instruction n belongs to chain n % ilp. Each chain keeps its value
+    // in register (chain % regs) and every instruction of the chain
+    // reads it, so the chain is a run of true dependences. A new chain
+    // starts every chain instructions from a register of another chain.
+    // With fewer registers than chains, chains share registers and
+    // depend on each other.
+    for (n = 0; n < count; ++n) {
+	c = n % ilp;
+	pos = (n / ilp) % chain;
+	reg = c % regs;
+	other = (reg + 1 + (rng() % regs)) % regs;
+
+	memset(&rec, 0, sizeof(rec));
+
+	switch (pickGroup(weights, total)) {
+	    case (MIX_INT):
+		rec.op = N_ADD + (rng() % 4);
+		break;
+	    case (MIX_IMM):
+		rec.op = N_LIZ + (rng() % 3);
+		break;
+	    case (MIX_MUL):
+		rec.op = N_MUL;
+		break;
+	    case (MIX_DIV):
+		rec.op = (rng() % 2) ? N_DIV : N_MOD;
+		break;
+	    case (MIX_LOAD):
+		rec.op = N_LW;
+		break;
+	    case (MIX_STORE):
+		rec.op = N_SW;
+		break;
+	    case (MIX_PUT):
+		rec.op = N_PUT;
+		break;
+	}
+
+	rec.rd = reg;
+	rec.rs = (pos == 0) ? other : reg;
+
+	// Only the fields the text format carries, so every format of the
+	// trace holds the same records
+	switch (rec.op) {
+	    case (N_LIZ):
+	    case (N_LIS):
+	    case (N_LUI):
+		rec.rs = 0;
+		rec.imm8 = rng() & 0xFF;
+		break;
+	    case (N_LW):
+		break;
+	    case (N_SW):
+	    case (N_PUT):
+		// Consumers only, the chain value is unchanged
+		rec.rd = 0;
+		rec.rt = reg;
+		rec.rs = other;
+		if (rec.op == N_PUT) {
+		    rec.rs = reg;
+		    rec.rt = 0;
+		}
+		break;
+	    default:
+		rec.rt = (pos == 0) ? other : reg;
+		break;
+	}
+
+	writeTrace(&trace, rec);
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    rec.op = N_HALT;
+    writeTrace(&trace, rec);
+
+    closeTraceWriter(&trace);
+
+    cout << trace.count << " instructions written" << endl;
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+#!/bin/sh
+# //////////////////////////////////////////////////////////////////
+# File: check.sh
+# Description: Regression checks for cases the demo programs do not
+#		reach. Each check builds its inputs in build/test, runs
+#		the tools and compares what they print or write.
+# Usage: test/check.sh
+# //////////////////////////////////////////////////////////////////
+
+DIR=build/test
+CONFIGS=bench/configs
+FAILED=0
+
+mkdir -p $DIR
+
+# Report one check, keep going after a failure
+result() {
+    if [ "$2" = 0 ]; then
+	echo "PASS $1"
+    else
+	echo "FAIL $1"
+	FAILED=1
+    fi
+}
+
+# One slow DIV holds back the timeline rows of 900 younger ADDs, far
+# more rows than stations. Every row must come out once, in order.
+timeline_blocked() {
+    {
+	echo "DIV R1 R2 R3"
+	for i in $(seq 900); do
+	    echo "ADD R4 R5 R6"
+	done
+	echo "HALT"
+    } > $DIR/blocked.txt
+    sed 's/"latency": 8/"latency": 3000/' $CONFIGS/base.json > $DIR/slowdiv.json
+
+    bin/tomsim -v error -t $DIR/blocked.tl $DIR/blocked.txt $DIR/slowdiv.json $DIR/out.json > /dev/null &&
+	bin/tquery -f seq $DIR/blocked.tl | tail -n +2 > $DIR/rows.txt &&
+	seq 902 | cmp -s - $DIR/rows.txt
+    result timeline_blocked $?
+}
+
+# A checkpoint taken with one CDB must not resume on a machine with a
+# different number of buses, its broadcast counts would not fit.
+checkpoint_cdb() {
+    {
+	for i in $(seq 300); do
+	    echo "ADD R1 R2 R3"
+	    echo "MUL R4 R5 R6"
+	done
+	echo "HALT"
+    } > $DIR/cdb.txt
+    sed 's/}}$/}, "cdb": {"width": 1}}/' $CONFIGS/base.json > $DIR/cdb1.json
+    sed 's/}}$/}, "cdb": {"width": 4}}/' $CONFIGS/base.json > $DIR/cdb4.json
+    rm -f $DIR/cdb4.out.json
+
+    bin/tomsim -v error -c $DIR/cdb.ckpt -n 100 $DIR/cdb.txt $DIR/cdb1.json $DIR/out.json > /dev/null &&
+	bin/tomsim -v error -R $DIR/cdb.ckpt $DIR/cdb.txt $DIR/cdb1.json $DIR/out.json > /dev/null &&
+	bin/tomsim -v error -R $DIR/cdb.ckpt $DIR/cdb.txt $DIR/cdb4.json $DIR/cdb4.out.json | grep -q "common data buses" &&
+	[ ! -f $DIR/cdb4.out.json ]
+    result checkpoint_cdb $?
+}
+
+# A decoded program and its text trace converted to binary must give
+# the same records, byte for byte.
+xsim_binary() {
+    status=0
+    for program in test/demotestA.txt test/demotestB.txt test/demotestC_D.txt; do
+	bin/xsim $program $DIR/program.txt > /dev/null &&
+	    bin/xsim -b $program $DIR/program.bin > /dev/null &&
+	    bin/tconv -b $DIR/program.txt $DIR/converted.bin > /dev/null &&
+	    cmp -s $DIR/program.bin $DIR/converted.bin || status=1
+    done
+    result xsim_binary $status
+}
+
+# A generated trace holds the same records in every format
+tracegen_formats() {
+    bin/tracegen -n 100000 -s 3 $DIR/gen.bin > /dev/null &&
+	bin/tracegen -n 100000 -s 3 -t $DIR/gen.txt > /dev/null &&
+	bin/tracegen -n 100000 -s 3 -z $DIR/gen.tz > /dev/null &&
+	bin/tconv -b $DIR/gen.txt $DIR/text.bin > /dev/null &&
+	bin/tconv -b $DIR/gen.tz $DIR/packed.bin > /dev/null &&
+	cmp -s $DIR/gen.bin $DIR/text.bin &&
+	cmp -s $DIR/gen.bin $DIR/packed.bin
+    result tracegen_formats $?
+}
+
+# Three dependent DIVs of a billion cycles each run past 2^31 cycles,
+# skipped with -e. The counts and the timeline keep every bit.
+long_run() {
+    {
+	echo "DIV R1 R1 R1"
+	echo "DIV R1 R1 R1"
+	echo "DIV R1 R1 R1"
+	echo "HALT"
+    } > $DIR/long.txt
+    sed 's/"latency": 8/"latency": 1000000000/' $CONFIGS/base.json > $DIR/long.json
+
+    bin/tomsim -e -v error -t $DIR/long.tl $DIR/long.txt $DIR/long.json $DIR/long.out.json > /dev/null &&
+	grep -q '"cycles" : 3000000005,' $DIR/long.out.json &&
+	bin/tquery -f seq,wb -o DIV $DIR/long.tl | tail -n 1 | grep -q "^3	3000000004$"
+    result long_run $?
+}
+
+# A checkpoint cut short anywhere is refused with a message, the
+# restore never runs on part of the state
+checkpoint_truncated() {
+    status=0
+    {
+	echo "DIV R1 R2 R3"
+	for i in $(seq 200); do
+	    echo "ADD R4 R5 R6"
+	    echo "MUL R1 R4 R2"
+	done
+	echo "HALT"
+    } > $DIR/busy.txt
+    sed 's/"latency": 8/"latency": 300/' $CONFIGS/base.json > $DIR/busy.json
+
+    bin/tomsim -v error -c $DIR/busy.ckpt -n 150 $DIR/busy.txt $DIR/busy.json $DIR/out.json > /dev/null || status=1
+    size=$(wc -c < $DIR/busy.ckpt)
+    for length in $(seq 0 97 $((size - 1))); do
+	head -c $length $DIR/busy.ckpt > $DIR/cut.ckpt
+	bin/tomsim -v error -R $DIR/cut.ckpt $DIR/busy.txt $DIR/busy.json $DIR/out.json 2> /dev/null | grep -aq "damaged\|not a checkpoint" || status=1
+    done
+    result checkpoint_truncated $status
+}
+
+# Sampling progress only resumes under the same -S periods
+checkpoint_sample() {
+    bin/tomsim -v error -S 10,100,5 -c $DIR/sample.ckpt -n 150 $DIR/busy.txt $DIR/busy.json $DIR/out.json > /dev/null &&
+	bin/tomsim -S 10,100,5 -R $DIR/sample.ckpt $DIR/busy.txt $DIR/busy.json $DIR/out.json | grep -q "Resuming" &&
+	bin/tomsim -v error -S 10,200,5 -R $DIR/sample.ckpt $DIR/busy.txt $DIR/busy.json $DIR/out.json | grep -q "this run is with -S 10,200,5" &&
+	bin/tomsim -v error -R $DIR/sample.ckpt $DIR/busy.txt $DIR/busy.json $DIR/out.json | grep -q "without -S"
+    result checkpoint_sample $?
+}
+
+# Recordings cannot start part way into a resumed run
+checkpoint_recording() {
+    bin/tomsim -v error -c $DIR/busy.ckpt -n 150 $DIR/busy.txt $DIR/busy.json $DIR/out.json > /dev/null &&
+	bin/tomsim -v error -R $DIR/busy.ckpt -t $DIR/resumed.tl $DIR/busy.txt $DIR/busy.json $DIR/out.json | grep -q "cannot be combined" &&
+	bin/tomsim -v error -R $DIR/busy.ckpt -r $DIR/resumed.ev $DIR/busy.txt $DIR/busy.json $DIR/out.json | grep -q "cannot be combined"
+    result checkpoint_recording $?
+}
+
+# Events of an instruction whose issue is not in the file are skipped.
+# The header and 5 class labels take 96 bytes, the first event is the
+# issue of the DIV, seq 1.
+ptrace_orphans() {
+    bin/tomsim -v error -r $DIR/busy.ev $DIR/busy.txt $DIR/busy.json $DIR/out.json > /dev/null &&
+	{ head -c 96 $DIR/busy.ev; tail -c +121 $DIR/busy.ev; } > $DIR/orphan.ev &&
+	bin/ptrace $DIR/orphan.ev $DIR/orphan.json > /dev/null &&
+	bin/ptrace -k $DIR/orphan.ev $DIR/orphan.kanata > /dev/null &&
+	! grep -q '"DIV 1"' $DIR/orphan.json &&
+	! grep -q "^[A-Z]	1	" $DIR/orphan.kanata
+    result ptrace_orphans $?
+}
+
+timeline_blocked
+checkpoint_cdb
+checkpoint_truncated
+checkpoint_sample
+checkpoint_recording
+ptrace_orphans
+long_run
+xsim_binary
+tracegen_formats
+
+exit $FAILED